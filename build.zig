@@ -6,6 +6,14 @@ pub fn build(b: *std.Build) !void {
 
     // Add option to choose between shared and static library
     const shared = b.option(bool, "shared", "Build shared library instead of static (default: false)") orelse false;
+    const vector_length = b.option(
+        usize,
+        "vector-length",
+        "Vector length in bytes of the default dialect, 0 disables SIMD (default: chosen per CPU)",
+    );
+    const options = b.addOptions();
+    options.addOption(?usize, "vector_length", vector_length);
+    const options_module = options.createModule();
 
     const lib = b.addLibrary(.{
         .name = "csvzero",
@@ -15,6 +23,9 @@ pub fn build(b: *std.Build) !void {
             .target = target,
             .optimize = optimize,
             .link_libc = true,
+            .imports = &.{
+                .{ .name = "build_options", .module = options_module },
+            },
         }),
     });
     b.installArtifact(lib);
@@ -25,6 +36,9 @@ pub fn build(b: *std.Build) !void {
     const mod = b.addModule("csvzero", .{
         .root_source_file = b.path("src/root.zig"),
         .target = target,
+        .imports = &.{
+            .{ .name = "build_options", .module = options_module },
+        },
     });
 
     const mod_tests = b.addTest(.{
@@ -34,6 +48,7 @@ pub fn build(b: *std.Build) !void {
             .optimize = optimize,
             .imports = &.{
                 .{ .name = "csvzero", .module = mod },
+                .{ .name = "build_options", .module = options_module },
             },
         }),
     });
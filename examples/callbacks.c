@@ -41,39 +41,45 @@ int main(int argc, const char *argv[]) {
     perror("failed to open file\n");
     return 1;
   }
-  csvz_iterator *it =
-      csvz_iter_from_callback(&ctx, read, buffer, sizeof(buffer));
+  csvz_dialect dialect = {',', '"', CSVZ_CRLF_TRIM, 0, 1};
+  csvz_iterator *it = csvz_iter_from_callback_with_dialect(
+      &ctx, read, buffer, sizeof(buffer), &dialect);
   if (!it) {
     printf("err %d encountered creating it\n", csvz_err());
     return 1;
   }
   csvz_field field;
-  csvz_error err;
+  csvz_position pos;
+  csvz_error err = CSVZ_OK;
 
-  size_t row = 0, col = 0;
-  while ((err = csvz_iter_next(it, &field)) == CSVZ_OK) {
+  // the position is that of the field the next call returns, or fails on.
+  while (csvz_iter_position(it, &pos) == CSVZ_OK &&
+         (err = csvz_iter_next(it, &field)) == CSVZ_OK) {
     if (field.needs_unescape) {
       field.len = csvz_unescape_in_place(field.data, field.len);
     }
 
-    printf("field[%zu][%zu] = |%.*s|\n", row, col, (int)field.len, field.data);
-    if (field.last_column) {
-      row++;
-      col = 0;
-    } else {
-      col++;
-    }
+    printf("field[%llu][%llu] = |%.*s|\n", (unsigned long long)pos.row,
+           (unsigned long long)pos.column, (int)field.len, field.data);
   }
 
+  csvz_iter_position(it, &pos);
   switch (err) {
   case CSVZ_ERR_FIELD_TOO_LONG:
-    printf("> field too long at row=%zu, col=%zu\n", row, col);
+    printf("> field too long at row=%llu, col=%llu, byte=%llu\n",
+           (unsigned long long)pos.row, (unsigned long long)pos.column,
+           (unsigned long long)pos.offset);
     break;
   case CSVZ_ERR_INVALID_QUOTES:
-    printf("invalid quotes at row=%zu, col=%zu\n", row, col);
+    printf("invalid quotes at row=%llu, col=%llu, byte=%llu\n",
+           (unsigned long long)pos.row, (unsigned long long)pos.column,
+           (unsigned long long)pos.offset);
   case CSVZ_ERR_EOF:
     break;
   default:
-    printf("err %d encountered at row=%zu, col=%zu\n", err, row, col);
+    printf("err %d encountered at row=%llu, col=%llu, byte=%llu\n", err,
+           (unsigned long long)pos.row, (unsigned long long)pos.column,
+           (unsigned long long)pos.offset);
   }
+  csvz_iter_free(it);
 }
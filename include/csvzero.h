@@ -1,6 +1,7 @@
 #ifndef CSVZERO_H
 #define CSVZERO_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -25,13 +26,18 @@ typedef struct csvz_iterator csvz_iterator;
  * @brief Error codes returned by CSV parsing operations
  */
 typedef enum {
-  CSVZ_OK,                 /**< Operation succeeded */
-  CSVZ_ERR_OOM,            /**< Out of memory */
-  CSVZ_ERR_FIELD_TOO_LONG, /**< Field exceeds buffer size */
-  CSVZ_ERR_EOF,            /**< End of file reached */
-  CSVZ_ERR_INVALID_QUOTES, /**< Malformed quoted field */
-  CSVZ_ERR_READ_FAILED,    /**< I/O read operation failed */
-  CSVZ_ERR_OPEN_ERROR,     /**< Failed to open file */
+  CSVZ_OK,                  /**< Operation succeeded */
+  CSVZ_ERR_OOM,             /**< Out of memory */
+  CSVZ_ERR_FIELD_TOO_LONG,  /**< Field exceeds buffer size */
+  CSVZ_ERR_EOF,             /**< End of file reached */
+  CSVZ_ERR_INVALID_QUOTES,  /**< Malformed quoted field */
+  CSVZ_ERR_READ_FAILED,     /**< I/O read operation failed */
+  CSVZ_ERR_OPEN_ERROR,      /**< Failed to open file */
+  CSVZ_ERR_INVALID_FILE,    /**< FILE* has no usable file descriptor */
+  CSVZ_ERR_TOO_MANY_GROUPS, /**< Aggregation exceeded its group limit */
+  CSVZ_ERR_TOO_MANY_COLUMNS,/**< Profile exceeded its column limit */
+  CSVZ_ERR_INVALID_DIALECT, /**< Dialect quote/delimiter are unusable */
+  CSVZ_ERR_POSITION_NOT_TRACKED, /**< Iterator created without track_position */
 } csvz_error;
 
 /**
@@ -45,6 +51,8 @@ typedef struct {
   size_t len;         /**< Length of field in bytes */
   int last_column;    /**< 1 if this is the last column in the row */
   int needs_unescape; /**< 1 if field contains escaped quotes ("") */
+  int partial;        /**< 1 if the field continues in the next chunk, see
+                           csvz_iter_next_chunk() */
 } csvz_field;
 
 /**
@@ -64,6 +72,32 @@ typedef struct {
   csvz_read_status status; /**< Status of the read operation */
 } csvz_read_result;
 
+/**
+ * @brief How a '\r' before the '\n' that ends a row is handled
+ */
+typedef enum {
+  CSVZ_CRLF_TRIM, /**< Dropped, rows may end with "\r\n" or "\n" (default) */
+  CSVZ_CRLF_KEEP, /**< Kept as part of the last field of the row */
+} csvz_crlf_policy;
+
+/**
+ * @brief CSV dialect for the csvz_iter_from_*_with_dialect() constructors
+ *
+ * Common dialects (',', ';', tab or '|' delimited with '"' or '\'' quotes,
+ * '\n' terminated and CSVZ_CRLF_TRIM, without track_position) use parsers
+ * specialized at compile time. Any other
+ * combination uses a generic parser that is still vectorized, but slightly
+ * slower. Escape characters, comment lines, trimming and single line fields
+ * are only available from Zig.
+ */
+typedef struct {
+  char delimiter;          /**< Field delimiter, e.g. ',' or '\t' */
+  char quote;              /**< Quote character, e.g. '"', 0 if never quoted */
+  csvz_crlf_policy crlf;   /**< Handling of "\r\n" row endings */
+  char terminator;         /**< Byte ending a row, 0 for '\n' (e.g. '\r' or 0x1E) */
+  int track_position;      /**< Nonzero to enable csvz_iter_position() */
+} csvz_dialect;
+
 /**
  * @brief Create a CSV iterator that reads from a file
  *
@@ -72,8 +106,10 @@ typedef struct {
  *
  * @param filename Path to the CSV file
  * @param buffer User-provided buffer for parsing (must remain valid for
- *               the iterator's lifetime)
- * @param len Size of the buffer in bytes
+ *               the iterator's lifetime), or NULL to let the iterator
+ *               allocate one of the size chosen by csvz_autotune() (64KB by
+ *               default)
+ * @param len Size of the buffer in bytes, ignored if buffer is NULL
  * @return Pointer to iterator, or NULL on error (call csvz_err() for details)
  *
  * @note The buffer must be large enough to hold the longest field in the CSV.
@@ -90,8 +126,8 @@ csvz_iterator *csvz_iter_from_file(const char *filename, char *buffer,
  *
  * @param fd Open file descriptor
  * @param buffer User-provided buffer for parsing (must remain valid for
- *               the iterator's lifetime)
- * @param len Size of the buffer in bytes
+ *               the iterator's lifetime), or NULL, see csvz_iter_from_file()
+ * @param len Size of the buffer in bytes, ignored if buffer is NULL
  * @return Pointer to iterator, or NULL on error (call csvz_err() for details)
  */
 csvz_iterator *csvz_iter_from_fd(FILE *fd, char *buffer, size_t len);
@@ -123,8 +159,8 @@ csvz_iterator *csvz_iter_from_bytes(char *data, size_t len);
  *             Signature: csvz_read_result read(void *context, char *buffer,
  *                                              size_t len)
  * @param buffer User-provided buffer for parsing (must remain valid for
- *               the iterator's lifetime)
- * @param len Size of the buffer in bytes
+ *               the iterator's lifetime), or NULL, see csvz_iter_from_file()
+ * @param len Size of the buffer in bytes, ignored if buffer is NULL
  * @return Pointer to iterator, or NULL on error (call csvz_err() for details)
  *
  * @note The callback should fill the buffer with up to len bytes and return
@@ -136,6 +172,93 @@ csvz_iterator *csvz_iter_from_callback(void *context,
                                                                 size_t len),
                                        char *buffer, size_t len);
 
+/**
+ * @brief Same as csvz_iter_from_file() with a custom dialect
+ *
+ * @param dialect Dialect to parse with (copied, NULL for the default)
+ * @return Pointer to iterator, or NULL on error (CSVZ_ERR_INVALID_DIALECT if
+ *         the quote, delimiter and terminator are not distinct or the quote
+ *         or delimiter is '\r' or '\n')
+ *
+ * Example usage:
+ *
+ *   csvz_dialect tsv = {'\t', '"', CSVZ_CRLF_TRIM, 0, 0};
+ *   csvz_iterator *iter = csvz_iter_from_file_with_dialect(
+ *       "data.tsv", buffer, sizeof(buffer), &tsv);
+ */
+csvz_iterator *csvz_iter_from_file_with_dialect(const char *filename,
+                                                char *buffer, size_t len,
+                                                const csvz_dialect *dialect);
+
+/**
+ * @brief Same as csvz_iter_from_fd() with a custom dialect
+ */
+csvz_iterator *csvz_iter_from_fd_with_dialect(FILE *fd, char *buffer,
+                                              size_t len,
+                                              const csvz_dialect *dialect);
+
+/**
+ * @brief Same as csvz_iter_from_bytes() with a custom dialect
+ */
+csvz_iterator *csvz_iter_from_bytes_with_dialect(char *data, size_t len,
+                                                 const csvz_dialect *dialect);
+
+/**
+ * @brief Same as csvz_iter_from_callback() with a custom dialect
+ */
+csvz_iterator *csvz_iter_from_callback_with_dialect(
+    void *context,
+    csvz_read_result (*read)(void *context, char *buffer, size_t len),
+    char *buffer, size_t len, const csvz_dialect *dialect);
+
+/**
+ * @brief Dialect detected by csvz_iter_from_file_auto()
+ */
+typedef struct {
+  char delimiter; /**< One of ',', ';', '\t' or '|' */
+  char quote;     /**< '"' or '\'' */
+  int crlf;       /**< 1 if rows end with "\r\n" */
+  int bom;        /**< 1 if the file starts with a UTF-8 BOM (skipped) */
+  int header;     /**< 1 if the first row looks like a header */
+  size_t columns; /**< Most common number of columns in the sample */
+} csvz_sniff_result;
+
+/**
+ * @brief Create a CSV iterator for a file of unknown dialect
+ *
+ * Like csvz_iter_from_file(), but sniffs the first 16KB (or the buffer size,
+ * if smaller) to detect the delimiter (',', ';', tab or '|'), the quote
+ * character ('"' or '\''), CRLF line endings, a UTF-8 byte order mark and
+ * whether the first row is a header. The iterator then parses with the
+ * detected delimiter and quote. A byte order mark is skipped, the header row
+ * is NOT.
+ *
+ * @param filename Path to the CSV file
+ * @param buffer User-provided buffer for parsing (must remain valid for
+ *               the iterator's lifetime), or NULL to let the iterator
+ *               allocate one of the size chosen by csvz_autotune() (64KB by
+ *               default)
+ * @param len Size of the buffer in bytes, ignored if buffer is NULL
+ * @param result Receives the detected dialect, can be NULL
+ * @return Pointer to iterator, or NULL on error (call csvz_err() for details)
+ */
+csvz_iterator *csvz_iter_from_file_auto(const char *filename, char *buffer,
+                                        size_t len, csvz_sniff_result *result);
+
+/**
+ * @brief Let the iterator grow its buffer for fields that do not fit
+ *
+ * Instead of failing with CSVZ_ERR_FIELD_TOO_LONG, the iterator reads into a
+ * heap allocated buffer twice the size of the current one, up to `max_len`
+ * bytes. The caller's buffer is used again as soon as the buffered data fits
+ * in half of it, so inputs without oversized fields never allocate. The
+ * buffer is released by csvz_iter_free().
+ *
+ * @param iter CSV iterator
+ * @param max_len Maximum buffer size in bytes
+ */
+void csvz_iter_set_max_buffer_size(csvz_iterator *iter, size_t max_len);
+
 /**
  * @brief Free a CSV iterator and release its resources
  *
@@ -171,6 +294,14 @@ void csvz_iter_free(csvz_iterator *iter);
  */
 size_t csvz_unescape_in_place(char *data, size_t len);
 
+/**
+ * @brief Unescape field data of a dialect with a custom quote character
+ *
+ * Same as csvz_unescape_in_place() but converts doubled `quote` characters,
+ * for iterators created with a csvz_dialect whose quote is not '"'.
+ */
+size_t csvz_unescape_in_place_with_quote(char *data, size_t len, char quote);
+
 /**
  * @brief Parse the next CSV field from the iterator
  *
@@ -205,6 +336,316 @@ size_t csvz_unescape_in_place(char *data, size_t len);
  */
 csvz_error csvz_iter_next(csvz_iterator *iter, csvz_field *field);
 
+/**
+ * @brief Get the next field, splitting oversized fields into chunks
+ *
+ * Same as csvz_iter_next(), but a field that does not fit in the buffer is
+ * returned in several chunks instead of failing with
+ * CSVZ_ERR_FIELD_TOO_LONG. Every chunk but the last one of a field has
+ * field->partial set to 1, and field->last_column is only meaningful on the
+ * last one. Escaped quotes never span two chunks, so each chunk can be
+ * unescaped on its own.
+ *
+ * @param iter CSV iterator
+ * @param field Pointer to csvz_field structure to populate
+ * @return Same as csvz_iter_next()
+ *
+ * @note Once a partial chunk is returned, keep calling
+ *       csvz_iter_next_chunk() up to the last chunk of the field.
+ *
+ * Example usage:
+ *
+ *   csvz_field field;
+ *   while (csvz_iter_next_chunk(iter, &field) == CSVZ_OK) {
+ *     if (field.needs_unescape) {
+ *       field.len = csvz_unescape_in_place(field.data, field.len);
+ *     }
+ *     fwrite(field.data, 1, field.len, out);
+ *     if (!field.partial) {
+ *       fputc(field.last_column ? '\n' : ',', out);
+ *     }
+ *   }
+ */
+csvz_error csvz_iter_next_chunk(csvz_iterator *iter, csvz_field *field);
+
+/**
+ * @brief Position of a field in the input
+ */
+typedef struct {
+  uint64_t offset; /**< Byte offset of the start of the field */
+  uint64_t row;    /**< Zero-based row */
+  uint64_t column; /**< Zero-based column */
+} csvz_position;
+
+/**
+ * @brief Get the position of the next field, or of the field that failed
+ *
+ * After csvz_iter_next() returns CSVZ_OK, this is the position of the field
+ * the next call returns. After it fails (e.g. with CSVZ_ERR_INVALID_QUOTES),
+ * it is the position of the field that could not be parsed.
+ *
+ * @param iter CSV iterator created with a csvz_dialect whose track_position
+ *             is nonzero
+ * @param position Pointer to csvz_position structure to populate
+ * @return CSVZ_OK on success
+ *         CSVZ_ERR_POSITION_NOT_TRACKED if the iterator does not track
+ *         positions
+ */
+csvz_error csvz_iter_position(const csvz_iterator *iter,
+                              csvz_position *position);
+
+/**
+ * @brief Aggregate functions for csvz_aggregate()
+ */
+typedef enum {
+  CSVZ_AGG_COUNT, /**< Number of rows in the group (column is ignored) */
+  CSVZ_AGG_SUM,   /**< Sum of the numeric values in the column */
+  CSVZ_AGG_MIN,   /**< Smallest numeric value (+inf if none) */
+  CSVZ_AGG_MAX,   /**< Largest numeric value (-inf if none) */
+} csvz_agg_op;
+
+/**
+ * @brief An aggregate function applied to one column
+ */
+typedef struct {
+  size_t column;  /**< Zero based column index */
+  csvz_agg_op op; /**< Aggregate function */
+} csvz_aggregate;
+
+/**
+ * @brief Value of one aggregate, use count for CSVZ_AGG_COUNT and number
+ *        for every other op
+ */
+typedef union {
+  uint64_t count;
+  double number;
+} csvz_agg_value;
+
+/**
+ * @brief One group of an aggregation result
+ *
+ * key and values point into the result and stay valid until
+ * csvz_agg_result_free() is called. The key is NOT null-terminated.
+ */
+typedef struct {
+  const char *key;              /**< Raw (unescaped) key bytes */
+  size_t key_len;               /**< Length of the key in bytes */
+  const csvz_agg_value *values; /**< One value per requested aggregate */
+} csvz_agg_group;
+
+/**
+ * @brief Opaque result of csvz_aggregate()
+ */
+typedef struct csvz_agg_result csvz_agg_result;
+
+/**
+ * @brief Group the remaining rows of an iterator by a key column
+ *
+ * Consumes the iterator until the end of the input and computes the
+ * requested aggregates for every distinct value of the key column. Fields
+ * that are empty or not numeric are ignored by sum, min and max. Rows that
+ * do not have the key column are ignored.
+ *
+ * @param iter CSV iterator (consumed, but must still be freed by the caller)
+ * @param key_column Zero based index of the key column
+ * @param aggregates Aggregates to compute (copied, need not outlive the call)
+ * @param len Number of aggregates
+ * @param header 1 to skip the first row
+ * @param max_groups Maximum number of distinct keys, 0 for the default
+ *                   (16M). Bounds the memory used by the result.
+ * @return Result, or NULL on error (call csvz_err() for details, e.g.
+ *         CSVZ_ERR_TOO_MANY_GROUPS or CSVZ_ERR_INVALID_QUOTES)
+ *
+ * Example usage:
+ *
+ *   csvz_aggregate aggs[] = {{0, CSVZ_AGG_COUNT}, {2, CSVZ_AGG_SUM}};
+ *   csvz_agg_result *res = csvz_aggregate(iter, 1, aggs, 2, 1, 0);
+ *   csvz_agg_group group;
+ *   for (size_t i = 0; csvz_agg_result_get(res, i, &group) == CSVZ_OK; i++) {
+ *     printf("%.*s: %llu rows, total %f\n", (int)group.key_len, group.key,
+ *            (unsigned long long)group.values[0].count,
+ *            group.values[1].number);
+ *   }
+ *   csvz_agg_result_free(res);
+ */
+csvz_agg_result *csvz_aggregate(csvz_iterator *iter, size_t key_column,
+                                const csvz_aggregate *aggregates, size_t len,
+                                int header, size_t max_groups);
+
+/**
+ * @brief Number of groups in an aggregation result
+ */
+size_t csvz_agg_result_len(const csvz_agg_result *result);
+
+/**
+ * @brief Get a group of an aggregation result
+ *
+ * @return CSVZ_OK, or CSVZ_ERR_EOF if index is past the last group
+ */
+csvz_error csvz_agg_result_get(const csvz_agg_result *result, size_t index,
+                               csvz_agg_group *group);
+
+/**
+ * @brief Free an aggregation result
+ */
+void csvz_agg_result_free(csvz_agg_result *result);
+
+/**
+ * @brief Profile the remaining rows of an iterator as JSON
+ *
+ * Consumes the iterator until the end of the input in a single pass and
+ * returns a JSON report with, for every column: inferred type, field count,
+ * empty count and rate, min/max length, an approximate distinct count
+ * (HyperLogLog) and, for numeric columns, min, max and approximate
+ * quantiles. Memory is fixed per column (roughly 40 KiB) regardless of the
+ * input size, up to 4096 columns.
+ *
+ * @param iter CSV iterator (consumed, but must still be freed by the caller)
+ * @param header 1 to use the first row as column names
+ * @return Null-terminated JSON string to be freed with csvz_string_free(),
+ *         or NULL on error (call csvz_err() for details, e.g.
+ *         CSVZ_ERR_TOO_MANY_COLUMNS or CSVZ_ERR_INVALID_QUOTES)
+ *
+ * Example output:
+ *
+ *   {"rows":2,"columns":[{"index":0,"name":"id","type":"integer",
+ *     "count":2,"empty":0,"empty_rate":0.000000,"min_length":1,
+ *     "max_length":1,"distinct":2,"min":1,"max":2,
+ *     "quantiles":{"0.5":1,...}}]}
+ */
+char *csvz_profile_json(csvz_iterator *iter, int header);
+
+/**
+ * @brief Free a string returned by the library
+ */
+void csvz_string_free(char *string);
+
+/**
+ * @brief Inferred type of a column
+ */
+typedef enum {
+  CSVZ_TYPE_EMPTY,     /**< Every sampled field was empty */
+  CSVZ_TYPE_BOOLEAN,   /**< true or false, in any case */
+  CSVZ_TYPE_INTEGER,   /**< Integer with an optional sign */
+  CSVZ_TYPE_FLOAT,     /**< Decimal number with an optional exponent */
+  CSVZ_TYPE_DATE,      /**< YYYY-MM-DD */
+  CSVZ_TYPE_TIMESTAMP, /**< YYYY-MM-DD[T ]HH:MM:SS[.fff][Z|+HH:MM] */
+  CSVZ_TYPE_STRING,    /**< Anything else */
+} csvz_type;
+
+/**
+ * @brief Column of an inferred schema
+ *
+ * The name points into the schema and is valid until csvz_schema_free()
+ * is called. The name is NOT null-terminated and is empty when the schema
+ * was inferred without a header row.
+ */
+typedef struct {
+  const char *name; /**< Column name (not null-terminated) */
+  size_t name_len;  /**< Length of the name in bytes */
+  csvz_type type;   /**< Narrowest type of every non-empty sampled field */
+  int nullable;     /**< 1 if any sampled field was empty or missing */
+} csvz_column;
+
+/**
+ * @brief Opaque result of csvz_infer_schema()
+ */
+typedef struct csvz_schema csvz_schema;
+
+/**
+ * @brief Infer column types from the first rows of an iterator
+ *
+ * Reads up to sample_rows rows (after the header, if any) and classifies
+ * every field. Fields are classified on their raw bytes and the iterator
+ * can keep being used afterwards for the remaining rows.
+ *
+ * @param iter CSV iterator
+ * @param header 1 to use the first row as column names
+ * @param sample_rows Number of rows to sample, 0 for the default (1000)
+ * @return Schema, or NULL on error (call csvz_err() for details)
+ *
+ * Example usage:
+ *
+ *   csvz_schema *schema = csvz_infer_schema(iter, 1, 0);
+ *   csvz_column column;
+ *   for (size_t i = 0; csvz_schema_get(schema, i, &column) == CSVZ_OK; i++) {
+ *     printf("%.*s: %d\n", (int)column.name_len, column.name, column.type);
+ *   }
+ *   csvz_schema_free(schema);
+ */
+csvz_schema *csvz_infer_schema(csvz_iterator *iter, int header,
+                               size_t sample_rows);
+
+/**
+ * @brief Number of columns in a schema
+ */
+size_t csvz_schema_len(const csvz_schema *schema);
+
+/**
+ * @brief Get a column of a schema
+ *
+ * @return CSVZ_OK, or CSVZ_ERR_EOF if index is past the last column
+ */
+csvz_error csvz_schema_get(const csvz_schema *schema, size_t index,
+                           csvz_column *column);
+
+/**
+ * @brief Free a schema
+ */
+void csvz_schema_free(csvz_schema *schema);
+
+/**
+ * @brief Result of csvz_autotune()
+ */
+typedef struct {
+  size_t buffer_size; /**< Fastest buffer size in bytes */
+} csvz_tuning;
+
+/**
+ * @brief Pick the fastest buffer size for this machine
+ *
+ * Parses the sample with every buffer size candidate and keeps the fastest
+ * one. Iterators created afterwards with a NULL buffer allocate a buffer of
+ * that size. The scan uses the vector length the library was built with, see
+ * csvz_vector_length() and -Dvector-length=<bytes>.
+ *
+ * @param sample A few hundred KB to a few MB of the actual input
+ * @param len Size of the sample in bytes
+ * @param cache_dir Directory of a cache file keyed by CPU model (created if
+ *                  missing): a cached result is used without calibrating.
+ *                  NULL always calibrates.
+ * @param dialect Dialect of the sample (NULL for the default)
+ * @param tuning Receives the result, may be NULL
+ * @return CSVZ_OK on success
+ *         CSVZ_ERR_INVALID_DIALECT, CSVZ_ERR_OOM, or CSVZ_ERR_OPEN_ERROR if
+ *         the cache cannot be read or written
+ *
+ * @note Thread-safe: iterators created concurrently use either the previous
+ *       or the new size.
+ */
+csvz_error csvz_autotune(const char *sample, size_t len, const char *cache_dir,
+                         const csvz_dialect *dialect, csvz_tuning *tuning);
+
+/**
+ * @brief Get the vector length the library scans with
+ *
+ * @return Vector length in bytes, chosen per CPU when the library was built
+ *         or set with -Dvector-length, 0 if SIMD is disabled
+ */
+size_t csvz_vector_length(void);
+
+/**
+ * @brief Get the vector length of the CPU running the program
+ *
+ * On SVE and RISC-V V CPUs the vector length is only known at runtime. Compare
+ * it with csvz_vector_length() to check that the library was built for the
+ * hardware, and rebuild with -Dvector-length=<bytes> otherwise.
+ *
+ * @return Vector length in bytes, the build-time choice on other
+ *         architectures, 0 if SIMD is disabled
+ */
+size_t csvz_hardware_vector_length(void);
+
 /**
  * @brief Get the last error code
  *
@@ -0,0 +1,721 @@
+const std = @import("std");
+const iterator = @import("iterator.zig");
+const parallel = @import("parallel.zig");
+const Allocator = std.mem.Allocator;
+
+/// Aggregate functions supported by the group-by engine.
+pub const Op = enum(c_int) {
+    /// Number of rows in the group. The column of the aggregate is ignored.
+    count,
+    /// Sum of the numeric values in the column.
+    sum,
+    /// Smallest numeric value in the column (+inf if the group has none).
+    min,
+    /// Largest numeric value in the column (-inf if the group has none).
+    max,
+};
+
+/// An aggregate function applied to one column of every row in a group.
+pub const Aggregate = struct {
+    column: usize,
+    op: Op,
+};
+
+/// The running value of one aggregate for one group. `count` is used for `Op.count` and `number`
+/// for every other op.
+pub const Accumulator = extern union {
+    count: u64,
+    number: f64,
+
+    fn init(op: Op) Accumulator {
+        return switch (op) {
+            .count => .{ .count = 0 },
+            .sum => .{ .number = 0 },
+            .min => .{ .number = std.math.inf(f64) },
+            .max => .{ .number = -std.math.inf(f64) },
+        };
+    }
+
+    inline fn update(self: *Accumulator, op: Op, value: f64) void {
+        switch (op) {
+            .count => self.count += 1,
+            .sum => if (!std.math.isNan(value)) {
+                self.number += value;
+            },
+            .min => if (!std.math.isNan(value)) {
+                self.number = @min(self.number, value);
+            },
+            .max => if (!std.math.isNan(value)) {
+                self.number = @max(self.number, value);
+            },
+        }
+    }
+
+    fn combine(self: *Accumulator, op: Op, other: Accumulator) void {
+        switch (op) {
+            .count => self.count += other.count,
+            .sum => self.number += other.number,
+            .min => self.number = @min(self.number, other.number),
+            .max => self.number = @max(self.number, other.number),
+        }
+    }
+};
+
+/// Open-addressing hash table from raw key bytes to a row of accumulators.
+///
+/// Keys are interned in an arena the first time they are seen; looking up an existing key only
+/// hashes and compares the bytes in place. Slots only hold the hash and the group index so growing
+/// the table never moves keys or accumulators. The number of groups is bounded by `max_groups`.
+pub const Table = struct {
+    allocator: Allocator,
+    ops: []const Op,
+    max_groups: usize,
+    arena: std.heap.ArenaAllocator,
+    slots: []Slot = &.{},
+    keys: std.ArrayList([]const u8) = .empty,
+    hashes: std.ArrayList(u64) = .empty,
+    /// `ops.len` accumulators per group, stored group after group.
+    accumulators: std.ArrayList(Accumulator) = .empty,
+    /// total length of the interned keys.
+    key_bytes: usize = 0,
+
+    const Slot = struct { hash: u64, group: u32 };
+    const empty_group = std.math.maxInt(u32);
+
+    pub const Error = error{TooManyGroups} || Allocator.Error;
+
+    /// `ops` must remain valid for the lifetime of the table.
+    pub fn init(allocator: Allocator, ops: []const Op, max_groups: usize) Table {
+        return .{
+            .allocator = allocator,
+            .ops = ops,
+            .max_groups = @min(max_groups, empty_group),
+            .arena = .init(allocator),
+        };
+    }
+
+    pub fn deinit(self: *Table) void {
+        self.allocator.free(self.slots);
+        self.keys.deinit(self.allocator);
+        self.hashes.deinit(self.allocator);
+        self.accumulators.deinit(self.allocator);
+        self.arena.deinit();
+    }
+
+    /// Number of groups in the table.
+    pub fn len(self: *const Table) usize {
+        return self.keys.items.len;
+    }
+
+    /// Key bytes of the given group.
+    pub fn key(self: *const Table, index: usize) []const u8 {
+        return self.keys.items[index];
+    }
+
+    /// Accumulators of the given group, one per op.
+    pub fn accumulatorsOf(self: *const Table, index: usize) []Accumulator {
+        return self.accumulators.items[index * self.ops.len ..][0..self.ops.len];
+    }
+
+    /// Approximate number of bytes used by the groups in the table.
+    pub fn memoryUsage(self: *const Table) usize {
+        const per_group = @sizeOf([]const u8) + @sizeOf(u64) + self.ops.len * @sizeOf(Accumulator);
+        return self.key_bytes + self.len() * per_group + self.slots.len * @sizeOf(Slot);
+    }
+
+    /// Removes every group while keeping the allocated memory around for reuse.
+    pub fn reset(self: *Table) void {
+        @memset(self.slots, .{ .hash = 0, .group = empty_group });
+        self.keys.clearRetainingCapacity();
+        self.hashes.clearRetainingCapacity();
+        self.accumulators.clearRetainingCapacity();
+        self.key_bytes = 0;
+        _ = self.arena.reset(.retain_capacity);
+    }
+
+    pub fn hash(bytes: []const u8) u64 {
+        return std.hash.Wyhash.hash(0, bytes);
+    }
+
+    /// Returns the group of `key_bytes`, creating it (and copying the key) if it is new.
+    pub fn group(self: *Table, key_bytes: []const u8) Error!u32 {
+        return self.groupHashed(key_bytes, hash(key_bytes));
+    }
+
+    /// Same as `group` with a precomputed `Table.hash` of the key.
+    pub fn groupHashed(self: *Table, key_bytes: []const u8, key_hash: u64) Error!u32 {
+        if (self.slots.len == 0) try self.grow();
+
+        const mask = self.slots.len - 1;
+        var i: usize = @as(usize, @truncate(key_hash)) & mask;
+        while (self.slots[i].group != empty_group) : (i = (i + 1) & mask) {
+            const slot = self.slots[i];
+            if (slot.hash == key_hash and std.mem.eql(u8, self.keys.items[slot.group], key_bytes)) {
+                @branchHint(.likely);
+                return slot.group;
+            }
+        }
+
+        if (self.len() >= self.max_groups) return error.TooManyGroups;
+        try self.keys.ensureUnusedCapacity(self.allocator, 1);
+        try self.hashes.ensureUnusedCapacity(self.allocator, 1);
+        try self.accumulators.ensureUnusedCapacity(self.allocator, self.ops.len);
+        const owned = try self.arena.allocator().dupe(u8, key_bytes);
+
+        const new_group: u32 = @intCast(self.len());
+        self.key_bytes += owned.len;
+        self.keys.appendAssumeCapacity(owned);
+        self.hashes.appendAssumeCapacity(key_hash);
+        for (self.ops) |op| self.accumulators.appendAssumeCapacity(.init(op));
+        self.slots[i] = .{ .hash = key_hash, .group = new_group };
+
+        // keep the load factor under 70%.
+        if (self.len() * 10 > self.slots.len * 7) try self.grow();
+        return new_group;
+    }
+
+    /// Updates the accumulators of a group with one row. `values` holds the parsed value for each op
+    /// (NaN when the field is missing or not numeric).
+    pub inline fn update(self: *Table, group_index: u32, values: []const f64) void {
+        const accumulators = self.accumulatorsOf(group_index);
+        for (self.ops, accumulators, values) |op, *acc, value| acc.update(op, value);
+    }
+
+    /// Folds every group of `other` into this table. Both tables must use the same ops.
+    pub fn merge(self: *Table, other: *const Table) Error!void {
+        std.debug.assert(std.mem.eql(Op, self.ops, other.ops));
+        for (other.keys.items, other.hashes.items, 0..) |key_bytes, key_hash, index| {
+            try self.mergeGroup(key_bytes, key_hash, other.accumulatorsOf(index));
+        }
+    }
+
+    /// Folds a single group, given by its key, `Table.hash` and accumulators, into this table.
+    pub fn mergeGroup(self: *Table, key_bytes: []const u8, key_hash: u64, from: []const Accumulator) Error!void {
+        const into = self.accumulatorsOf(try self.groupHashed(key_bytes, key_hash));
+        for (self.ops, into, from) |op, *acc, other| acc.combine(op, other);
+    }
+
+    fn grow(self: *Table) Allocator.Error!void {
+        const new_len = @max(16, self.slots.len * 2);
+        const slots = try self.allocator.alloc(Slot, new_len);
+        @memset(slots, .{ .hash = 0, .group = empty_group });
+
+        const mask = new_len - 1;
+        for (self.hashes.items, 0..) |key_hash, index| {
+            var i: usize = @as(usize, @truncate(key_hash)) & mask;
+            while (slots[i].group != empty_group) i = (i + 1) & mask;
+            slots[i] = .{ .hash = key_hash, .group = @intCast(index) };
+        }
+
+        self.allocator.free(self.slots);
+        self.slots = slots;
+    }
+};
+
+/// Configuration for an `Aggregator`.
+pub const AggregateOptions = struct {
+    /// Zero based index of the column whose raw (unescaped) bytes form the group key.
+    key_column: usize,
+    /// Aggregates computed for every group.
+    aggregates: []const Aggregate,
+    /// When true, the first row is skipped.
+    header: bool = false,
+    /// Upper bound on the number of distinct keys, which bounds the memory use of the table.
+    max_groups: usize = default_max_groups,
+
+    pub const default_max_groups = 1 << 24;
+};
+
+/// Creates a streaming group-by type for CSV data in the specified dialect.
+///
+/// Rows are read field by field from a `Csv(dialect)` iterator. The key field is looked up in the
+/// `Table` as soon as it is read (so it never has to outlive the reader buffer), value fields are parsed
+/// into a per-row scratch array and the group's accumulators are updated in place at the end of the row.
+/// Fields after the last column of interest are skipped. Rows that do not have the key column are
+/// counted in `skipped` and ignored.
+///
+/// Example:
+/// ```zig
+/// var aggregator = try csvz.Aggregator(.{}).init(allocator, .{
+///     .key_column = 0,
+///     .aggregates = &.{ .{ .column = 0, .op = .count }, .{ .column = 2, .op = .sum } },
+///     .header = true,
+/// });
+/// defer aggregator.deinit();
+/// try aggregator.consume(&it);
+/// for (0..aggregator.table.len()) |group| {
+///     const totals = aggregator.table.accumulatorsOf(group);
+///     std.debug.print("{s}: {d} rows, sum={d}\n", .{ aggregator.table.key(group), totals[0].count, totals[1].number });
+/// }
+/// ```
+pub fn Aggregator(comptime dialect: iterator.Dialect) type {
+    return struct {
+        allocator: Allocator,
+        options: Options,
+        table: Table,
+        ops: []Op,
+        /// parsed value of every aggregate for the current row.
+        row_values: []f64,
+        /// the last column that the aggregation needs to look at.
+        last_column: usize,
+        /// Rows aggregated so far.
+        rows: usize = 0,
+        /// Rows ignored because they do not have the key column.
+        skipped: usize = 0,
+
+        const Self = @This();
+        pub const Iterator = iterator.Csv(dialect);
+        pub const Options = AggregateOptions;
+        pub const Error = Iterator.Error || Table.Error;
+
+        /// `options.aggregates` must remain valid for the lifetime of the aggregator.
+        pub fn init(allocator: Allocator, options: Options) Allocator.Error!Self {
+            const ops = try allocator.alloc(Op, options.aggregates.len);
+            errdefer allocator.free(ops);
+            const row_values = try allocator.alloc(f64, options.aggregates.len);
+
+            var last_column = options.key_column;
+            for (options.aggregates, ops) |aggregate, *op| {
+                op.* = aggregate.op;
+                if (aggregate.op != .count) last_column = @max(last_column, aggregate.column);
+            }
+
+            return .{
+                .allocator = allocator,
+                .options = options,
+                .table = .init(allocator, ops, options.max_groups),
+                .ops = ops,
+                .row_values = row_values,
+                .last_column = last_column,
+            };
+        }
+
+        pub fn deinit(self: *Self) void {
+            self.table.deinit();
+            self.allocator.free(self.ops);
+            self.allocator.free(self.row_values);
+        }
+
+        /// Aggregates every remaining row of `it` until the end of the input.
+        pub fn consume(self: *Self, it: *Iterator) Error!void {
+            if (self.options.header) {
+                it.skipRow() catch |err| switch (err) {
+                    error.EOF => return,
+                    else => |e| return e,
+                };
+            }
+
+            while (true) {
+                self.consumeRow(it) catch |err| switch (err) {
+                    error.EOF => return,
+                    else => |e| return e,
+                };
+            }
+        }
+
+        /// Aggregates the next row of `it`. Returns `error.EOF` at the end of the input.
+        pub fn consumeRow(self: *Self, it: *Iterator) Error!void {
+            @memset(self.row_values, std.math.nan(f64));
+            var group: ?u32 = null;
+            var column: usize = 0;
+            while (true) : (column += 1) {
+                var field = try it.next();
+                if (column == self.options.key_column) {
+                    group = try self.table.group(field.unescaped());
+                }
+                for (self.options.aggregates, self.row_values) |aggregate, *value| {
+                    if (aggregate.column == column and aggregate.op != .count) {
+                        value.* = parseNumber(field.unescaped()) orelse std.math.nan(f64);
+                    }
+                }
+
+                if (field.last_column) break;
+                if (column == self.last_column) {
+                    try it.skipRow();
+                    break;
+                }
+            }
+
+            if (group) |index| {
+                self.table.update(index, self.row_values);
+                self.rows += 1;
+            } else {
+                self.skipped += 1;
+            }
+        }
+    };
+}
+
+/// Configuration for `aggregateParallel`.
+pub const ParallelAggregateOptions = struct {
+    /// Zero based index of the column whose raw (unescaped) bytes form the group key.
+    key_column: usize,
+    /// Aggregates computed for every group.
+    aggregates: []const Aggregate,
+    /// When true, the first row is skipped.
+    header: bool = false,
+    /// Upper bound on the number of distinct keys in the result.
+    max_groups: usize = AggregateOptions.default_max_groups,
+    /// Number of threads, 0 uses one per CPU.
+    threads: usize = 0,
+    /// Approximate number of bytes the per-thread tables may use together while scanning. A thread whose
+    /// table outgrows its share spills the table to `spill_dir` and starts over with an empty one.
+    /// The budget only bounds the scan: the merged `PartitionedTable` holds every group in memory,
+    /// so the result must fit in memory on its own (see `max_groups`).
+    memory_budget: usize = 1 << 30,
+    /// log2 of the number of key hash partitions. Spilled groups are written to one file per partition
+    /// and the final merge builds one table per partition, each on its own thread.
+    partition_bits: u5 = 6,
+    /// Directory for the temporary spill files, which are deleted before returning. When null, a
+    /// thread exceeding its share of the budget fails with `error.MemoryBudgetExceeded`.
+    spill_dir: ?std.fs.Dir = null,
+};
+
+pub const ParallelAggregateError = iterator.Csv(.{}).Error || Table.Error || error{ MemoryBudgetExceeded, SpillFailed };
+
+/// Result of `aggregateParallel`: every group lives in exactly one of the partition tables.
+pub const PartitionedTable = struct {
+    allocator: Allocator,
+    ops: []Op,
+    partitions: []Table,
+    /// Rows aggregated.
+    rows: usize = 0,
+    /// Rows ignored because they do not have the key column.
+    skipped: usize = 0,
+
+    fn init(allocator: Allocator, aggregates: []const Aggregate, count: usize, max_groups: usize) Allocator.Error!PartitionedTable {
+        const ops = try allocator.alloc(Op, aggregates.len);
+        errdefer allocator.free(ops);
+        for (aggregates, ops) |aggregate, *op| op.* = aggregate.op;
+        const partitions = try allocator.alloc(Table, count);
+        for (partitions) |*table| table.* = .init(allocator, ops, max_groups);
+        return .{ .allocator = allocator, .ops = ops, .partitions = partitions };
+    }
+
+    pub fn deinit(self: *PartitionedTable) void {
+        for (self.partitions) |*table| table.deinit();
+        self.allocator.free(self.partitions);
+        self.allocator.free(self.ops);
+    }
+
+    /// Total number of groups.
+    pub fn len(self: *const PartitionedTable) usize {
+        var total: usize = 0;
+        for (self.partitions) |*table| total += table.len();
+        return total;
+    }
+};
+
+/// Groups the rows of `data` using every core.
+///
+/// `data` is split into one chunk per thread at row boundaries (see `parallel.splitRows`) and every thread
+/// aggregates its chunk into a thread-local `Table`, spilling it to per-partition files whenever it grows past
+/// its share of `memory_budget`. The tables and spill files are then radix-partitioned by key hash and each
+/// partition is merged into its own table by one of the threads, so the merge scales with large
+/// cardinalities too. Use `parallel.MappedFile` to aggregate files that do not fit in memory. Only the
+/// scan is bounded by `memory_budget`, the merge reads the spill files back into the resulting tables.
+///
+/// Fields are unescaped in place, so `data` is modified. `allocator` must be thread-safe.
+pub fn aggregateParallel(
+    comptime dialect: iterator.Dialect,
+    allocator: Allocator,
+    data: []u8,
+    options: ParallelAggregateOptions,
+) ParallelAggregateError!PartitionedTable {
+    const Worker = ScanWorker(dialect);
+    const Job = MergeJob(Worker);
+    const thread_count = if (options.threads != 0) options.threads else std.Thread.getCpuCount() catch 1;
+    const partition_count = @as(usize, 1) << options.partition_bits;
+
+    var result: PartitionedTable = try .init(allocator, options.aggregates, partition_count, options.max_groups);
+    errdefer result.deinit();
+
+    // rows of a `single_line_fields` dialect end at every terminator, no quote has to be counted.
+    const row_quote = if (dialect.single_line_fields) null else dialect.quote;
+    // escaped quotes and comment lines break the quote parity, rows are walked instead.
+    const boundaries = if (row_quote != null and (dialect.escape != null or dialect.comment != null))
+        try parallel.splitRowsWalking(allocator, data, thread_count, .{
+            .quote = row_quote.?,
+            .escape = dialect.escape,
+            .comment = dialect.comment,
+            .terminator = dialect.terminator,
+        })
+    else
+        try parallel.splitRowsWithTerminator(allocator, data, thread_count, row_quote, dialect.terminator);
+    defer allocator.free(boundaries);
+
+    const workers = try allocator.alloc(Worker, boundaries.len - 1);
+    defer allocator.free(workers);
+    var initialized: usize = 0;
+    defer for (workers[0..initialized]) |*worker| worker.deinit();
+
+    const run_id = std.crypto.random.int(u64);
+    for (workers, 0..) |*worker, index| {
+        worker.* = .{
+            .id = index,
+            .run_id = run_id,
+            .chunk = data[boundaries[index]..boundaries[index + 1]],
+            .header = options.header and index == 0,
+            .budget = options.memory_budget / workers.len,
+            .options = &options,
+            .aggregator = try .init(allocator, .{
+                .key_column = options.key_column,
+                .aggregates = options.aggregates,
+                .max_groups = options.max_groups,
+            }),
+        };
+        initialized += 1;
+    }
+
+    const threads = try allocator.alloc(?std.Thread, @max(workers.len, thread_count));
+    defer allocator.free(threads);
+
+    for (workers[1..], threads[1..workers.len]) |*worker, *thread| {
+        thread.* = std.Thread.spawn(.{}, Worker.run, .{worker}) catch null;
+        if (thread.* == null) worker.run();
+    }
+    workers[0].run();
+    for (threads[1..workers.len]) |thread| if (thread) |t| t.join();
+    for (workers) |*worker| {
+        try worker.result;
+        result.rows += worker.aggregator.rows;
+        result.skipped += worker.aggregator.skipped;
+    }
+
+    var job: Job = .{ .workers = workers, .partitions = result.partitions, .bits = options.partition_bits };
+    const merge_results = try allocator.alloc(ParallelAggregateError!void, @min(thread_count, partition_count));
+    defer allocator.free(merge_results);
+    for (merge_results[1..], threads[1..merge_results.len]) |*merge_result, *thread| {
+        thread.* = std.Thread.spawn(.{}, Job.run, .{ &job, merge_result }) catch null;
+        if (thread.* == null) job.run(merge_result);
+    }
+    job.run(&merge_results[0]);
+    for (threads[1..merge_results.len]) |thread| if (thread) |t| t.join();
+    for (merge_results) |merge_result| try merge_result;
+
+    if (result.len() > options.max_groups) return error.TooManyGroups;
+    return result;
+}
+
+inline fn partitionOf(key_hash: u64, bits: u5) usize {
+    if (bits == 0) return 0;
+    return @intCast(key_hash >> @intCast(64 - @as(u7, bits)));
+}
+
+/// Aggregates one chunk on its own thread and spills its table when it outgrows the budget.
+fn ScanWorker(comptime dialect: iterator.Dialect) type {
+    return struct {
+        id: usize,
+        run_id: u64,
+        chunk: []u8,
+        header: bool,
+        budget: usize,
+        options: *const ParallelAggregateOptions,
+        aggregator: Aggregator(dialect),
+        spill: ?Spill = null,
+        /// group indices of the table ordered by partition, partition `p` is `order[offsets[p]..offsets[p + 1]]`.
+        order: []u32 = &.{},
+        offsets: []usize = &.{},
+        result: ParallelAggregateError!void = {},
+
+        const Self = @This();
+        const spill_buffer_len = 4096;
+
+        const Spill = struct {
+            dir: std.fs.Dir,
+            files: []std.fs.File,
+            writers: []std.fs.File.Writer,
+            buffers: []u8,
+            /// number of files created so far.
+            opened: usize = 0,
+        };
+
+        fn run(self: *Self) void {
+            self.result = self.scan();
+        }
+
+        fn deinit(self: *Self) void {
+            const allocator = self.aggregator.allocator;
+            if (self.spill) |*spill| {
+                for (spill.files[0..spill.opened], 0..) |file, partition_index| {
+                    file.close();
+                    var name_buffer: [64]u8 = undefined;
+                    spill.dir.deleteFile(self.spillName(&name_buffer, partition_index)) catch {};
+                }
+                allocator.free(spill.files);
+                allocator.free(spill.writers);
+                allocator.free(spill.buffers);
+            }
+            allocator.free(self.order);
+            allocator.free(self.offsets);
+            self.aggregator.deinit();
+        }
+
+        fn scan(self: *Self) ParallelAggregateError!void {
+            var reader = std.Io.Reader.fixed(self.chunk);
+            var it = Aggregator(dialect).Iterator.init(&reader);
+            if (self.header) it.skipRow() catch |err| switch (err) {
+                error.EOF => {},
+                else => |e| return e,
+            };
+
+            while (true) {
+                self.aggregator.consumeRow(&it) catch |err| switch (err) {
+                    error.EOF => break,
+                    else => |e| return e,
+                };
+                if (self.aggregator.table.memoryUsage() > self.budget) {
+                    @branchHint(.unlikely);
+                    try self.spillTable();
+                }
+            }
+
+            try self.partition();
+        }
+
+        fn spillName(self: *const Self, buffer: []u8, partition_index: usize) []const u8 {
+            return std.fmt.bufPrint(buffer, "csvz-{x}-{d}-{d}.spill", .{ self.run_id, self.id, partition_index }) catch unreachable;
+        }
+
+        fn openSpill(self: *Self, dir: std.fs.Dir) ParallelAggregateError!*Spill {
+            self.spill = try allocSpill(self.aggregator.allocator, dir, @as(usize, 1) << self.options.partition_bits);
+            const spill = &self.spill.?;
+            for (spill.files, spill.writers, 0..) |*file, *writer, partition_index| {
+                var name_buffer: [64]u8 = undefined;
+                const name = self.spillName(&name_buffer, partition_index);
+                file.* = dir.createFile(name, .{ .read = true, .exclusive = true }) catch return error.SpillFailed;
+                spill.opened += 1;
+                writer.* = file.writer(spill.buffers[partition_index * spill_buffer_len ..][0..spill_buffer_len]);
+            }
+            return spill;
+        }
+
+        fn allocSpill(allocator: Allocator, dir: std.fs.Dir, count: usize) Allocator.Error!Spill {
+            const files = try allocator.alloc(std.fs.File, count);
+            errdefer allocator.free(files);
+            const writers = try allocator.alloc(std.fs.File.Writer, count);
+            errdefer allocator.free(writers);
+            const buffers = try allocator.alloc(u8, count * spill_buffer_len);
+            return .{ .dir = dir, .files = files, .writers = writers, .buffers = buffers };
+        }
+
+        fn spillTable(self: *Self) ParallelAggregateError!void {
+            const dir = self.options.spill_dir orelse return error.MemoryBudgetExceeded;
+            const spill = if (self.spill) |*existing| existing else try self.openSpill(dir);
+            const table = &self.aggregator.table;
+            for (table.keys.items, table.hashes.items, 0..) |key_bytes, key_hash, index| {
+                const writer = &spill.writers[partitionOf(key_hash, self.options.partition_bits)].interface;
+                writeGroup(writer, key_bytes, table.accumulatorsOf(index)) catch return error.SpillFailed;
+            }
+            for (spill.writers) |*writer| writer.interface.flush() catch return error.SpillFailed;
+            table.reset();
+        }
+
+        /// orders the groups of the in-memory table by partition (counting sort).
+        fn partition(self: *Self) Allocator.Error!void {
+            const allocator = self.aggregator.allocator;
+            const table = &self.aggregator.table;
+            const bits = self.options.partition_bits;
+            const count = @as(usize, 1) << bits;
+
+            self.offsets = try allocator.alloc(usize, count + 1);
+            @memset(self.offsets, 0);
+            for (table.hashes.items) |key_hash| self.offsets[partitionOf(key_hash, bits) + 1] += 1;
+            for (1..count + 1) |i| self.offsets[i] += self.offsets[i - 1];
+
+            const cursors = try allocator.dupe(usize, self.offsets[0..count]);
+            defer allocator.free(cursors);
+            self.order = try allocator.alloc(u32, table.len());
+            for (table.hashes.items, 0..) |key_hash, index| {
+                const cursor = &cursors[partitionOf(key_hash, bits)];
+                self.order[cursor.*] = @intCast(index);
+                cursor.* += 1;
+            }
+        }
+    };
+}
+
+/// Merges the thread-local tables and spill files, one partition at a time per thread.
+fn MergeJob(comptime Worker: type) type {
+    return struct {
+        workers: []Worker,
+        partitions: []Table,
+        bits: u5,
+        next: std.atomic.Value(usize) = .init(0),
+
+        const Self = @This();
+
+        fn run(self: *Self, result: *ParallelAggregateError!void) void {
+            result.* = self.mergeAll();
+        }
+
+        fn mergeAll(self: *Self) ParallelAggregateError!void {
+            while (true) {
+                const index = self.next.fetchAdd(1, .monotonic);
+                if (index >= self.partitions.len) return;
+                try self.mergePartition(index);
+            }
+        }
+
+        fn mergePartition(self: *Self, index: usize) ParallelAggregateError!void {
+            const table = &self.partitions[index];
+            for (self.workers) |*worker| {
+                const source = &worker.aggregator.table;
+                for (worker.order[worker.offsets[index]..worker.offsets[index + 1]]) |group| {
+                    try table.mergeGroup(source.key(group), source.hashes.items[group], source.accumulatorsOf(group));
+                }
+                if (worker.spill) |*spill| try readSpill(spill.files[index], table);
+            }
+        }
+    };
+}
+
+fn writeGroup(writer: *std.Io.Writer, key_bytes: []const u8, accumulators: []const Accumulator) std.Io.Writer.Error!void {
+    try writer.writeInt(u32, @intCast(key_bytes.len), .little);
+    try writer.writeAll(key_bytes);
+    for (accumulators) |acc| try writer.writeInt(u64, acc.count, .little);
+}
+
+fn readSpill(file: std.fs.File, table: *Table) ParallelAggregateError!void {
+    var buffer: [4096]u8 = undefined;
+    var file_reader = file.reader(&buffer);
+    const reader = &file_reader.interface;
+
+    var key_bytes: std.ArrayList(u8) = .empty;
+    defer key_bytes.deinit(table.allocator);
+    const accumulators = try table.allocator.alloc(Accumulator, table.ops.len);
+    defer table.allocator.free(accumulators);
+
+    while (true) {
+        const key_len = reader.takeInt(u32, .little) catch |err| switch (err) {
+            error.EndOfStream => return,
+            error.ReadFailed => return error.SpillFailed,
+        };
+        try key_bytes.resize(table.allocator, key_len);
+        reader.readSliceAll(key_bytes.items) catch return error.SpillFailed;
+        for (accumulators) |*acc| {
+            acc.* = .{ .count = reader.takeInt(u64, .little) catch return error.SpillFailed };
+        }
+        try table.mergeGroup(key_bytes.items, Table.hash(key_bytes.items), accumulators);
+    }
+}
+
+/// Parses a numeric field, with a fast path for plain integers. Returns null for anything that is
+/// not a number (including empty fields).
+pub fn parseNumber(bytes: []const u8) ?f64 {
+    if (bytes.len == 0) return null;
+    const negative = bytes[0] == '-';
+    const digits = if (negative or bytes[0] == '+') bytes[1..] else bytes;
+    if (digits.len > 0 and digits.len <= 18) {
+        var value: u64 = 0;
+        for (digits) |byte| {
+            const digit = byte -% '0';
+            if (digit > 9) break;
+            value = value * 10 + digit;
+        } else {
+            const number: f64 = @floatFromInt(value);
+            return if (negative) -number else number;
+        }
+    }
+    return std.fmt.parseFloat(f64, bytes) catch null;
+}
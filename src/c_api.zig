@@ -68,6 +68,7 @@ const Field = extern struct {
     len: usize,
     last_column: c_int,
     needs_unescape: c_int,
+    partial: c_int,
 };
 
 const Error = enum(c_int) {
@@ -79,12 +80,31 @@ const Error = enum(c_int) {
     ReadFailed,
     OpenError,
     InvalidFile,
+    TooManyGroups,
+    TooManyColumns,
+    InvalidDialect,
+    PositionNotTracked,
 };
 
+fn iteratorError(err: csvz.Iterator.Error) Error {
+    return switch (err) {
+        csvz.Iterator.Error.EOF => Error.EOF,
+        csvz.Iterator.Error.FieldTooLong => Error.FieldTooLong,
+        csvz.Iterator.Error.InvalidQuotes => Error.InvalidQuotes,
+        csvz.Iterator.Error.ReadFailed => Error.ReadFailed,
+    };
+}
+
 threadlocal var last_error: Error = .NoError;
 
+/// size of the buffers allocated for iterators created without one, see `csvz_autotune`. Atomic, as it may
+/// be tuned while other threads create iterators.
+var default_buffer_size: std.atomic.Value(usize) = .init(64 * 1024);
+
 const Iterator = struct {
-    iterator: csvz.Iterator,
+    iterator: csvz.AnyIterator,
+    /// allocated when the caller passes no buffer.
+    owned_buffer: ?[]u8 = null,
     source: union(enum) {
         file: FileSource,
         fd: FileSource,
@@ -93,22 +113,99 @@ const Iterator = struct {
     },
 };
 
-export fn csvz_iter_from_file(filename: [*:0]const u8, buffer: [*]u8, len: usize) callconv(.c) ?*Iterator {
+const CrlfPolicy = enum(c_int) {
+    trim,
+    keep,
+};
+
+const Dialect = extern struct {
+    delimiter: u8,
+    /// 0 for data without quotes.
+    quote: u8,
+    crlf: CrlfPolicy,
+    /// 0 for '\n'.
+    terminator: u8,
+    track_position: c_int,
+};
+
+/// converts a C dialect (null for the default one), sets last_error and returns null if it is invalid.
+fn runtimeDialect(dialect: ?*const Dialect) ?csvz.RuntimeDialect {
+    const from = dialect orelse return .{};
+    const settings: csvz.RuntimeDialect = .{
+        .delimiter = from.delimiter,
+        .quote = if (from.quote == 0) null else from.quote,
+        .terminator = if (from.terminator == 0) '\n' else from.terminator,
+        .trim_cr = from.crlf == .trim,
+    };
+    if (!settings.isValid()) {
+        last_error = .InvalidDialect;
+        return null;
+    }
+    return settings;
+}
+
+/// returns the caller's buffer, or allocates one owned by `it` if it is null. Sets last_error on failure.
+fn iteratorBuffer(it: *Iterator, buffer: ?[*]u8, len: usize) ?[]u8 {
+    it.owned_buffer = null;
+    if (buffer) |ptr| return ptr[0..len];
+    const owned = std.heap.c_allocator.alloc(u8, default_buffer_size.load(.monotonic)) catch {
+        last_error = .OOM;
+        return null;
+    };
+    it.owned_buffer = owned;
+    return owned;
+}
+
+/// creates the iterator for a dialect already validated by `runtimeDialect`.
+fn selectIterator(reader: *std.Io.Reader, dialect: ?*const Dialect, settings: csvz.RuntimeDialect) csvz.AnyIterator {
+    if (dialect) |from| {
+        if (from.track_position != 0) return csvz.AnyIterator.selectTracked(reader, settings) catch unreachable;
+    }
+    return csvz.AnyIterator.select(reader, settings) catch unreachable;
+}
+
+export fn csvz_iter_from_file(filename: [*:0]const u8, buffer: ?[*]u8, len: usize) callconv(.c) ?*Iterator {
+    return csvz_iter_from_file_with_dialect(filename, buffer, len, null);
+}
+
+export fn csvz_iter_from_file_with_dialect(
+    filename: [*:0]const u8,
+    buffer: ?[*]u8,
+    len: usize,
+    dialect: ?*const Dialect,
+) callconv(.c) ?*Iterator {
+    const settings = runtimeDialect(dialect) orelse return null;
     var it: *Iterator = std.heap.c_allocator.create(Iterator) catch {
         last_error = .OOM;
         return null;
     };
     const file = std.fs.cwd().openFileZ(filename, .{ .mode = .read_only }) catch {
+        std.heap.c_allocator.destroy(it);
         last_error = .OpenError;
         return null;
     };
-    it.source = .{ .file = .{ .handle = file, .reader = file.reader(buffer[0..len]) } };
-    it.iterator = csvz.Iterator.init(&it.source.file.reader.interface);
+    const slice = iteratorBuffer(it, buffer, len) orelse {
+        file.close();
+        std.heap.c_allocator.destroy(it);
+        return null;
+    };
+    it.source = .{ .file = .{ .handle = file, .reader = file.reader(slice) } };
+    it.iterator = selectIterator(&it.source.file.reader.interface, dialect, settings);
     last_error = .NoError;
     return it;
 }
 
-export fn csvz_iter_from_fd(stream: *c.FILE, buffer: [*]u8, len: usize) callconv(.c) ?*Iterator {
+export fn csvz_iter_from_fd(stream: *c.FILE, buffer: ?[*]u8, len: usize) callconv(.c) ?*Iterator {
+    return csvz_iter_from_fd_with_dialect(stream, buffer, len, null);
+}
+
+export fn csvz_iter_from_fd_with_dialect(
+    stream: *c.FILE,
+    buffer: ?[*]u8,
+    len: usize,
+    dialect: ?*const Dialect,
+) callconv(.c) ?*Iterator {
+    const settings = runtimeDialect(dialect) orelse return null;
     var it: *Iterator = std.heap.c_allocator.create(Iterator) catch {
         last_error = .OOM;
         return null;
@@ -118,6 +215,7 @@ export fn csvz_iter_from_fd(stream: *c.FILE, buffer: [*]u8, len: usize) callconv
             const file_no = c._fileno(stream);
             const handle = c._get_osfhandle(file_no);
             if (handle < 0) {
+                std.heap.c_allocator.destroy(it);
                 last_error = .InvalidFile;
                 return null;
             }
@@ -126,25 +224,36 @@ export fn csvz_iter_from_fd(stream: *c.FILE, buffer: [*]u8, len: usize) callconv
         else => blk: {
             const file_no = c.fileno(stream);
             if (file_no < 0) {
+                std.heap.c_allocator.destroy(it);
                 last_error = .InvalidFile;
                 return null;
             }
             break :blk file_no;
         },
     } };
-    it.source = .{ .fd = .{ .handle = file, .reader = file.reader(buffer[0..len]) } };
-    it.iterator = csvz.Iterator.init(&it.source.fd.reader.interface);
+    const slice = iteratorBuffer(it, buffer, len) orelse {
+        std.heap.c_allocator.destroy(it);
+        return null;
+    };
+    it.source = .{ .fd = .{ .handle = file, .reader = file.reader(slice) } };
+    it.iterator = selectIterator(&it.source.fd.reader.interface, dialect, settings);
     last_error = .NoError;
     return it;
 }
 
 export fn csvz_iter_from_bytes(buffer: [*]u8, len: usize) callconv(.c) ?*Iterator {
+    return csvz_iter_from_bytes_with_dialect(buffer, len, null);
+}
+
+export fn csvz_iter_from_bytes_with_dialect(buffer: [*]u8, len: usize, dialect: ?*const Dialect) callconv(.c) ?*Iterator {
+    const settings = runtimeDialect(dialect) orelse return null;
     var it: *Iterator = std.heap.c_allocator.create(Iterator) catch {
         last_error = .OOM;
         return null;
     };
+    it.owned_buffer = null;
     it.source = .{ .fixed_buffer = std.Io.Reader.fixed(buffer[0..len]) };
-    it.iterator = csvz.Iterator.init(&it.source.fixed_buffer);
+    it.iterator = selectIterator(&it.source.fixed_buffer, dialect, settings);
     last_error = .NoError;
     return it;
 }
@@ -152,15 +261,80 @@ export fn csvz_iter_from_bytes(buffer: [*]u8, len: usize) callconv(.c) ?*Iterato
 export fn csvz_iter_from_callback(
     ctx: *anyopaque,
     cb: CallbackSource.Fn,
-    buffer: [*]u8,
+    buffer: ?[*]u8,
+    len: usize,
+) callconv(.c) ?*Iterator {
+    return csvz_iter_from_callback_with_dialect(ctx, cb, buffer, len, null);
+}
+
+export fn csvz_iter_from_callback_with_dialect(
+    ctx: *anyopaque,
+    cb: CallbackSource.Fn,
+    buffer: ?[*]u8,
+    len: usize,
+    dialect: ?*const Dialect,
+) callconv(.c) ?*Iterator {
+    const settings = runtimeDialect(dialect) orelse return null;
+    var it: *Iterator = std.heap.c_allocator.create(Iterator) catch {
+        last_error = .OOM;
+        return null;
+    };
+    const slice = iteratorBuffer(it, buffer, len) orelse {
+        std.heap.c_allocator.destroy(it);
+        return null;
+    };
+    it.source = .{ .callback = .init(ctx, cb, slice) };
+    it.iterator = selectIterator(&it.source.callback.interface, dialect, settings);
+    last_error = .NoError;
+    return it;
+}
+
+const SniffResult = extern struct {
+    delimiter: u8,
+    quote: u8,
+    crlf: c_int,
+    bom: c_int,
+    header: c_int,
+    columns: usize,
+};
+
+export fn csvz_iter_from_file_auto(
+    filename: [*:0]const u8,
+    buffer: ?[*]u8,
     len: usize,
+    result: ?*SniffResult,
 ) callconv(.c) ?*Iterator {
     var it: *Iterator = std.heap.c_allocator.create(Iterator) catch {
         last_error = .OOM;
         return null;
     };
-    it.source = .{ .callback = .init(ctx, cb, buffer[0..len]) };
-    it.iterator = csvz.Iterator.init(&it.source.callback.interface);
+    const file = std.fs.cwd().openFileZ(filename, .{ .mode = .read_only }) catch {
+        std.heap.c_allocator.destroy(it);
+        last_error = .OpenError;
+        return null;
+    };
+    const slice = iteratorBuffer(it, buffer, len) orelse {
+        file.close();
+        std.heap.c_allocator.destroy(it);
+        return null;
+    };
+    it.source = .{ .file = .{ .handle = file, .reader = file.reader(slice) } };
+    var sniffed: csvz.Sniffed = undefined;
+    it.iterator = csvz.AnyIterator.initSniffed(&it.source.file.reader.interface, &sniffed) catch {
+        file.close();
+        if (it.owned_buffer) |owned| std.heap.c_allocator.free(owned);
+        std.heap.c_allocator.destroy(it);
+        last_error = .ReadFailed;
+        return null;
+    };
+    if (result) |out| out.* = .{
+        .delimiter = sniffed.delimiter,
+        .quote = sniffed.quote,
+        .crlf = @intFromBool(sniffed.crlf),
+        .bom = @intFromBool(sniffed.bom),
+        .header = @intFromBool(sniffed.header),
+        .columns = sniffed.columns,
+    };
     last_error = .NoError;
     return it;
 }
@@ -168,17 +342,38 @@ export fn csvz_iter_from_callback(
 export fn csvz_iter_next(it: *Iterator, field: *Field) callconv(.c) Error {
     const item = it.iterator.next() catch |err| {
         @branchHint(.unlikely);
-        switch (err) {
-            csvz.Iterator.Error.EOF => return Error.EOF,
-            csvz.Iterator.Error.FieldTooLong => return Error.FieldTooLong,
-            csvz.Iterator.Error.InvalidQuotes => return Error.InvalidQuotes,
-            csvz.Iterator.Error.ReadFailed => return Error.ReadFailed,
-        }
+        return iteratorError(err);
+    };
+    field.data = item.data.ptr;
+    field.len = item.data.len;
+    field.last_column = if (item.last_column) 1 else 0;
+    field.needs_unescape = if (item.needs_unescape) 1 else 0;
+    field.partial = 0;
+    return .NoError;
+}
+
+export fn csvz_iter_next_chunk(it: *Iterator, field: *Field) callconv(.c) Error {
+    const item = it.iterator.nextChunk() catch |err| {
+        @branchHint(.unlikely);
+        return iteratorError(err);
     };
     field.data = item.data.ptr;
     field.len = item.data.len;
     field.last_column = if (item.last_column) 1 else 0;
     field.needs_unescape = if (item.needs_unescape) 1 else 0;
+    field.partial = if (item.partial) 1 else 0;
+    return .NoError;
+}
+
+const Position = extern struct {
+    offset: u64,
+    row: u64,
+    column: u64,
+};
+
+export fn csvz_iter_position(it: *const Iterator, position: *Position) callconv(.c) Error {
+    const from = it.iterator.position() orelse return .PositionNotTracked;
+    position.* = .{ .offset = from.offset, .row = from.row, .column = from.column };
     return .NoError;
 }
 
@@ -187,14 +382,247 @@ export fn csvz_unescape_in_place(data: [*]u8, len: usize) usize {
     return it.unescapeInPlace('"', data[0..len]).len;
 }
 
+export fn csvz_unescape_in_place_with_quote(data: [*]u8, len: usize, quote: u8) usize {
+    const it = @import("iterator.zig");
+    return it.unescapeInPlace(quote, data[0..len]).len;
+}
+
+export fn csvz_iter_set_max_buffer_size(it: *Iterator, max_len: usize) callconv(.c) void {
+    it.iterator.allowGrowth(std.heap.c_allocator, max_len);
+}
+
 export fn csvz_iter_free(it: *Iterator) callconv(.c) void {
+    it.iterator.deinit();
     switch (it.source) {
         .file => |f| f.handle.close(),
         else => {},
     }
+    if (it.owned_buffer) |owned| std.heap.c_allocator.free(owned);
     std.heap.c_allocator.destroy(it);
 }
 
+const Aggregate = extern struct {
+    column: usize,
+    op: csvz.AggregateOp,
+};
+
+const AggregateGroup = extern struct {
+    key: [*]const u8,
+    key_len: usize,
+    values: [*]const csvz.Accumulator,
+};
+
+const AggregateResult = struct {
+    aggregates: []csvz.Aggregate,
+    aggregator: csvz.ByDialect(csvz.Aggregator),
+    /// table of the active aggregator.
+    table: *const csvz.AggregateTable,
+};
+
+export fn csvz_aggregate(
+    it: *Iterator,
+    key_column: usize,
+    aggregates: [*]const Aggregate,
+    len: usize,
+    header: c_int,
+    max_groups: usize,
+) callconv(.c) ?*AggregateResult {
+    const ally = std.heap.c_allocator;
+    var result = ally.create(AggregateResult) catch {
+        last_error = .OOM;
+        return null;
+    };
+    result.aggregates = ally.alloc(csvz.Aggregate, len) catch {
+        ally.destroy(result);
+        last_error = .OOM;
+        return null;
+    };
+    for (aggregates[0..len], result.aggregates) |from, *to| to.* = .{ .column = from.column, .op = from.op };
+    const options: csvz.Aggregator(.{}).Options = .{
+        .key_column = key_column,
+        .aggregates = result.aggregates,
+        .header = header != 0,
+        .max_groups = if (max_groups == 0) csvz.Aggregator(.{}).Options.default_max_groups else max_groups,
+    };
+    const consumed = switch (it.iterator.inner) {
+        inline else => |*inner, tag| consumed: {
+            const Aggregator = csvz.Aggregator(@TypeOf(inner.*).config);
+            const aggregator = Aggregator.init(ally, options) catch {
+                ally.free(result.aggregates);
+                ally.destroy(result);
+                last_error = .OOM;
+                return null;
+            };
+            result.aggregator = @unionInit(@TypeOf(result.aggregator), @tagName(tag), aggregator);
+            const active = &@field(result.aggregator, @tagName(tag));
+            result.table = &active.table;
+            break :consumed active.consume(inner);
+        },
+    };
+    consumed catch |err| {
+        csvz_agg_result_free(result);
+        last_error = switch (err) {
+            error.TooManyGroups => .TooManyGroups,
+            error.OutOfMemory => .OOM,
+            else => |e| iteratorError(e),
+        };
+        return null;
+    };
+    last_error = .NoError;
+    return result;
+}
+
+export fn csvz_agg_result_len(result: *const AggregateResult) callconv(.c) usize {
+    return result.table.len();
+}
+
+export fn csvz_agg_result_get(result: *const AggregateResult, index: usize, group: *AggregateGroup) callconv(.c) Error {
+    const table = result.table;
+    if (index >= table.len()) return .EOF;
+    const key = table.key(index);
+    group.* = .{ .key = key.ptr, .key_len = key.len, .values = table.accumulatorsOf(index).ptr };
+    return .NoError;
+}
+
+export fn csvz_agg_result_free(result: *AggregateResult) callconv(.c) void {
+    switch (result.aggregator) {
+        inline else => |*aggregator| aggregator.deinit(),
+    }
+    std.heap.c_allocator.free(result.aggregates);
+    std.heap.c_allocator.destroy(result);
+}
+
+export fn csvz_profile_json(it: *Iterator, header: c_int) callconv(.c) ?[*:0]u8 {
+    return switch (it.iterator.inner) {
+        inline else => |*inner| profileJson(@TypeOf(inner.*).config, inner, header != 0),
+    };
+}
+
+fn profileJson(comptime dialect: csvz.Dialect, it: *csvz.Csv(dialect), header: bool) ?[*:0]u8 {
+    const ally = std.heap.c_allocator;
+    var profiler = csvz.Profiler(dialect).init(ally, .{ .header = header });
+    defer profiler.deinit();
+    profiler.consume(it) catch |err| {
+        last_error = switch (err) {
+            error.TooManyColumns => .TooManyColumns,
+            error.OutOfMemory => .OOM,
+            else => |e| iteratorError(e),
+        };
+        return null;
+    };
+
+    var json: std.Io.Writer.Allocating = .init(ally);
+    defer json.deinit();
+    profiler.writeJson(&json.writer) catch {
+        last_error = .OOM;
+        return null;
+    };
+    json.writer.writeByte(0) catch {
+        last_error = .OOM;
+        return null;
+    };
+    const bytes = json.toOwnedSlice() catch {
+        last_error = .OOM;
+        return null;
+    };
+    last_error = .NoError;
+    return @ptrCast(bytes.ptr);
+}
+
+export fn csvz_string_free(string: [*:0]u8) callconv(.c) void {
+    const bytes = std.mem.span(string);
+    std.heap.c_allocator.free(bytes.ptr[0 .. bytes.len + 1]);
+}
+
+const SchemaColumn = extern struct {
+    name: [*]const u8,
+    name_len: usize,
+    type: csvz.ColumnType,
+    nullable: c_int,
+};
+
+export fn csvz_infer_schema(it: *Iterator, header: c_int, sample_rows: usize) callconv(.c) ?*csvz.Schema {
+    const ally = std.heap.c_allocator;
+    const result = ally.create(csvz.Schema) catch {
+        last_error = .OOM;
+        return null;
+    };
+    const options: csvz.SchemaOptions = .{
+        .header = header != 0,
+        .sample_rows = if (sample_rows == 0) (csvz.SchemaOptions{}).sample_rows else sample_rows,
+    };
+    result.* = switch (it.iterator.inner) {
+        inline else => |*inner| csvz.inferSchema(@TypeOf(inner.*).config, ally, inner, options),
+    } catch |err| {
+        ally.destroy(result);
+        last_error = switch (err) {
+            error.TooManyColumns => .TooManyColumns,
+            error.OutOfMemory => .OOM,
+            else => |e| iteratorError(e),
+        };
+        return null;
+    };
+    last_error = .NoError;
+    return result;
+}
+
+export fn csvz_schema_len(schema: *const csvz.Schema) callconv(.c) usize {
+    return schema.columns.len;
+}
+
+export fn csvz_schema_get(schema: *const csvz.Schema, index: usize, column: *SchemaColumn) callconv(.c) Error {
+    if (index >= schema.columns.len) return .EOF;
+    const from = schema.columns[index];
+    column.* = .{
+        .name = from.name.ptr,
+        .name_len = from.name.len,
+        .type = from.type,
+        .nullable = @intFromBool(from.nullable),
+    };
+    return .NoError;
+}
+
+export fn csvz_schema_free(schema: *csvz.Schema) callconv(.c) void {
+    schema.deinit();
+    std.heap.c_allocator.destroy(schema);
+}
+
+const Tuning = extern struct {
+    buffer_size: usize,
+};
+
+export fn csvz_autotune(
+    sample: [*]const u8,
+    len: usize,
+    cache_dir: ?[*:0]const u8,
+    dialect: ?*const Dialect,
+    tuning: ?*Tuning,
+) callconv(.c) Error {
+    const settings = runtimeDialect(dialect) orelse return .InvalidDialect;
+    const result = if (cache_dir) |path| blk: {
+        var dir = std.fs.cwd().makeOpenPath(std.mem.span(path), .{}) catch return .OpenError;
+        defer dir.close();
+        break :blk csvz.loadOrCalibrate(std.heap.c_allocator, dir, sample[0..len], settings) catch |err| switch (err) {
+            error.OutOfMemory => return .OOM,
+            else => return .OpenError,
+        };
+    } else csvz.calibrate(std.heap.c_allocator, sample[0..len], settings) catch |err| switch (err) {
+        error.OutOfMemory => return .OOM,
+        error.InvalidDialect => return .InvalidDialect,
+    };
+    default_buffer_size.store(result.buffer_size, .monotonic);
+    if (tuning) |out| out.* = .{ .buffer_size = result.buffer_size };
+    return .NoError;
+}
+
+export fn csvz_vector_length() callconv(.c) usize {
+    return csvz.Iterator.config.vector_length orelse 0;
+}
+
+export fn csvz_hardware_vector_length() callconv(.c) usize {
+    return csvz.runtimeVectorLength() orelse 0;
+}
+
 export fn csvz_err() callconv(.c) Error {
     return last_error;
 }
@@ -0,0 +1,216 @@
+const std = @import("std");
+const iterator = @import("iterator.zig");
+const sniff = @import("sniff.zig");
+const Reader = std.Io.Reader;
+const Dialect = iterator.Dialect;
+
+/// Dialects with a pre-instantiated `Csv` specialization, i.e. every combination of the candidates the
+/// sniffer chooses from, followed by a `runtime` dialect for everything else, one that also tracks
+/// positions, and the same two for data without quotes.
+pub const dialects = blk: {
+    var entries: [sniff.quote_candidates.len * sniff.delimiter_candidates.len + 4]Dialect = undefined;
+    for (sniff.quote_candidates, 0..) |quote, q| {
+        for (sniff.delimiter_candidates, 0..) |delimiter, d| {
+            entries[q * sniff.delimiter_candidates.len + d] = .{ .quote = quote, .delimiter = delimiter };
+        }
+    }
+    entries[entries.len - 4] = .{ .runtime = true };
+    entries[entries.len - 3] = .{ .runtime = true, .track_position = true };
+    entries[entries.len - 2] = .{ .runtime = true, .quote = null };
+    entries[entries.len - 1] = .{ .runtime = true, .quote = null, .track_position = true };
+    const final = entries;
+    break :blk final;
+};
+
+/// Identifies one of `dialects`.
+pub const DialectTag = blk: {
+    var fields: [dialects.len]std.builtin.Type.EnumField = undefined;
+    for (&fields, 0..) |*field, i| field.* = .{ .name = dialectName(dialects[i]), .value = i };
+    const final = fields;
+    break :blk @Type(.{ .@"enum" = .{
+        .tag_type = u8,
+        .fields = &final,
+        .decls = &.{},
+        .is_exhaustive = true,
+    } });
+};
+
+/// Creates a tagged union with one `Generic(dialect)` payload for each of `dialects`, e.g.
+/// `ByDialect(Csv)` holds any pre-instantiated iterator and `ByDialect(Aggregator)` any aggregator.
+pub fn ByDialect(comptime Generic: fn (comptime Dialect) type) type {
+    var fields: [dialects.len]std.builtin.Type.UnionField = undefined;
+    for (&fields, dialects) |*field, dialect| {
+        const T = Generic(dialect);
+        field.* = .{ .name = dialectName(dialect), .type = T, .alignment = @alignOf(T) };
+    }
+    const final = fields;
+    return @Type(.{ .@"union" = .{
+        .layout = .auto,
+        .tag_type = DialectTag,
+        .fields = &final,
+        .decls = &.{},
+    } });
+}
+
+fn dialectName(comptime dialect: Dialect) [:0]const u8 {
+    if (dialect.runtime) {
+        if (dialect.quote == null) return if (dialect.track_position) "runtime_unquoted_tracked" else "runtime_unquoted";
+        return if (dialect.track_position) "runtime_tracked" else "runtime";
+    }
+    const delimiter = switch (dialect.delimiter) {
+        ',' => "comma",
+        ';' => "semicolon",
+        '\t' => "tab",
+        '|' => "pipe",
+        else => unreachable,
+    };
+    const quote = switch (dialect.quote.?) {
+        '"' => "",
+        '\'' => "_single_quote",
+        else => unreachable,
+    };
+    return delimiter ++ quote;
+}
+
+/// A CSV iterator whose dialect is chosen at runtime among the pre-instantiated `dialects`.
+///
+/// Every call to `next()` dispatches to the specialized iterator with a single switch, so the SIMD scanning
+/// still uses comptime-known delimiter and quote masks. Dialects without a specialization fall back to the
+/// `runtime` one with masks splatted at runtime. Use `initSniffed` to detect the dialect.
+///
+/// Example:
+/// ```zig
+/// var sniffed: csvz.Sniffed = undefined;
+/// var it = try csvz.AnyIterator.initSniffed(&reader.interface, &sniffed);
+/// if (sniffed.header) try it.skipRow();
+/// while (true) {
+///     var field = it.next() catch |err| switch (err) {
+///         error.EOF => break,
+///         else => |e| return e,
+///     };
+///     std.debug.print("{s}\n", .{field.unescaped()});
+/// }
+/// ```
+pub const AnyIterator = struct {
+    inner: ByDialect(iterator.Csv),
+
+    /// Errors are the same for every dialect.
+    pub const Error = iterator.Csv(.{}).Error;
+
+    /// A field returned by `next()`, see `Csv.Field`.
+    pub const Field = struct {
+        data: []u8,
+        last_column: bool,
+        needs_unescape: bool = false,
+        partial: bool = false,
+        quote: u8,
+
+        pub fn unescaped(self: *Field) []u8 {
+            if (self.needs_unescape) {
+                self.needs_unescape = false;
+                self.data = iterator.unescapeInPlace(self.quote, self.data);
+            }
+            return self.data;
+        }
+    };
+
+    /// Creates an iterator for a comptime-known dialect, which must be one of `dialects`.
+    pub fn init(comptime dialect: Dialect, reader: *Reader) AnyIterator {
+        const tag = comptime std.meta.stringToEnum(DialectTag, dialectName(dialect)).?;
+        return .{ .inner = @unionInit(ByDialect(iterator.Csv), @tagName(tag), iterator.Csv(dialect).init(reader)) };
+    }
+
+    /// Creates an iterator for a dialect known at runtime, specialized if possible. Settings without a quote
+    /// get the `runtime_unquoted` iterator, whose scan skips quote handling entirely.
+    pub fn select(reader: *Reader, settings: iterator.RuntimeDialect) error{InvalidDialect}!AnyIterator {
+        if (settings.quote == null) {
+            const Unquoted = iterator.Csv(.{ .runtime = true, .quote = null });
+            return .{ .inner = .{ .runtime_unquoted = try Unquoted.initDialect(reader, settings) } };
+        }
+        inline for (dialects) |dialect| {
+            if (!dialect.runtime and settings.trim_cr and settings.terminator == dialect.terminator and
+                dialect.delimiter == settings.delimiter and dialect.quote.? == settings.quote.?) return init(dialect, reader);
+        }
+        const Runtime = iterator.Csv(.{ .runtime = true });
+        return .{ .inner = .{ .runtime = try Runtime.initDialect(reader, settings) } };
+    }
+
+    /// Creates an iterator for a dialect known at runtime that tracks positions, see `position()`.
+    pub fn selectTracked(reader: *Reader, settings: iterator.RuntimeDialect) error{InvalidDialect}!AnyIterator {
+        if (settings.quote == null) {
+            const Unquoted = iterator.Csv(.{ .runtime = true, .quote = null, .track_position = true });
+            return .{ .inner = .{ .runtime_unquoted_tracked = try Unquoted.initDialect(reader, settings) } };
+        }
+        const Tracked = iterator.Csv(.{ .runtime = true, .track_position = true });
+        return .{ .inner = .{ .runtime_tracked = try Tracked.initDialect(reader, settings) } };
+    }
+
+    /// Detects the dialect from the start of `reader` (see `sniffReader`) and creates an iterator for it.
+    /// A byte order mark is discarded. The detection result is written to `sniffed` when not null.
+    pub fn initSniffed(reader: *Reader, sniffed: ?*sniff.Sniffed) error{ReadFailed}!AnyIterator {
+        const result = try sniff.sniffReader(reader, sniff.default_sample_len);
+        if (sniffed) |out| out.* = result;
+        // the sniffer only ever picks candidates that have a specialization.
+        return select(reader, .{ .delimiter = result.delimiter, .quote = result.quote }) catch unreachable;
+    }
+
+    /// Returns the next field, see `Csv.next()`.
+    pub fn next(self: *AnyIterator) Error!Field {
+        switch (self.inner) {
+            inline else => |*it| {
+                const field = try it.next();
+                return .{
+                    .data = field.data,
+                    .last_column = field.last_column,
+                    .needs_unescape = field.needs_unescape,
+                    .quote = field.quoteChar(),
+                };
+            },
+        }
+    }
+
+    /// Returns the next field or chunk of an oversized field, see `Csv.nextChunk()`.
+    pub fn nextChunk(self: *AnyIterator) Error!Field {
+        switch (self.inner) {
+            inline else => |*it| {
+                const field = try it.nextChunk();
+                return .{
+                    .data = field.data,
+                    .last_column = field.last_column,
+                    .needs_unescape = field.needs_unescape,
+                    .partial = field.partial,
+                    .quote = field.quoteChar(),
+                };
+            },
+        }
+    }
+
+    /// Returns the position of the next field (see `Csv.position()`), null unless the iterator was created
+    /// with `selectTracked`.
+    pub fn position(self: *const AnyIterator) ?iterator.Position {
+        switch (self.inner) {
+            inline else => |*it| return if (comptime @TypeOf(it.*).tracks_position) it.position() else null,
+        }
+    }
+
+    /// Lets the iterator grow its buffer for oversized fields, see `Csv.allowGrowth()`.
+    pub fn allowGrowth(self: *AnyIterator, allocator: std.mem.Allocator, max_len: usize) void {
+        switch (self.inner) {
+            inline else => |*it| it.allowGrowth(allocator, max_len),
+        }
+    }
+
+    /// Frees the buffer allocated after `allowGrowth()`, see `Csv.deinit()`.
+    pub fn deinit(self: *AnyIterator) void {
+        switch (self.inner) {
+            inline else => |*it| it.deinit(),
+        }
+    }
+
+    /// Skips the rest of the current row, see `Csv.skipRow()`.
+    pub fn skipRow(self: *AnyIterator) Error!void {
+        switch (self.inner) {
+            inline else => |*it| try it.skipRow(),
+        }
+    }
+};
@@ -0,0 +1,280 @@
+const std = @import("std");
+const iterator = @import("iterator.zig");
+const simd = @import("simd.zig");
+const Emitter = @import("emitter.zig").Emitter;
+const Writer = std.Io.Writer;
+const Allocator = std.mem.Allocator;
+
+/// A test applied to a single column of every row.
+///
+/// A row matches when every predicate matches its column. Predicates on columns the row
+/// does not have never match.
+///
+/// Example:
+/// ```zig
+/// const predicates = [_]Predicate{
+///     .{ .column = 7, .match = .{ .contains = "timeout" } },
+///     .{ .column = 2, .match = .{ .range = .{ .min = 500, .max = 599 } } },
+/// };
+/// ```
+pub const Predicate = struct {
+    /// Zero based index of the column to test.
+    column: usize,
+    match: Match,
+
+    pub const Match = union(enum) {
+        /// The unescaped field is exactly the given bytes.
+        equals: []const u8,
+        /// The unescaped field starts with the given bytes.
+        prefix: []const u8,
+        /// The unescaped field contains the given bytes anywhere.
+        contains: []const u8,
+        /// The unescaped field matches a regex-lite pattern. Supported syntax is `c` (literal),
+        /// `.` (any byte), `*` (zero or more of the previous item), `^` (start) and `$` (end).
+        pattern: []const u8,
+        /// The field parses as a number within `[min, max]`.
+        range: Range,
+    };
+
+    pub const Range = struct {
+        min: f64 = -std.math.inf(f64),
+        max: f64 = std.math.inf(f64),
+    };
+
+    /// Returns true if the unescaped field `value` satisfies this predicate.
+    pub fn matches(self: *const Predicate, value: []const u8) bool {
+        return switch (self.match) {
+            .equals => |literal| std.mem.eql(u8, value, literal),
+            .prefix => |literal| std.mem.startsWith(u8, value, literal),
+            .contains => |literal| simd.indexOfPos(value, 0, literal) != null,
+            .pattern => |pattern| matchPattern(pattern, value),
+            .range => |range| blk: {
+                const number = std.fmt.parseFloat(f64, value) catch break :blk false;
+                break :blk number >= range.min and number <= range.max;
+            },
+        };
+    }
+};
+
+/// Configuration for a `Filter`.
+pub const FilterOptions = struct {
+    /// When true, the first row is always emitted and never tested against the predicates.
+    header: bool = false,
+    /// When true, rows that cannot match are discarded by a SIMD search over the raw buffered bytes
+    /// before they are tokenized (see `Csv.skipRowsWithout`). This only kicks in when a predicate
+    /// requires a literal (`equals`, `prefix`, `contains` or the literal part of a `pattern`).
+    prefilter: bool = true,
+};
+
+/// Counters reported by `Filter.run`.
+pub const FilterStats = struct {
+    /// Rows tokenized and tested against the predicates (excluding the header row).
+    /// Rows discarded by the raw-byte prefilter are not counted.
+    rows: usize = 0,
+    /// Rows that matched and were emitted.
+    matched: usize = 0,
+};
+
+/// Creates a row filter type for CSV data in the specified dialect.
+///
+/// The filter reads fields from a `Csv(dialect)` iterator and writes every row that satisfies
+/// all predicates to an `Emitter`. Predicates are evaluated as soon as their column is read, so a
+/// row is rejected on the first failing column and the rest of it is skipped with `skipRow()`.
+/// Only fields that precede the last predicate column are copied (into a reusable staging buffer)
+/// and only until the row is known to match; everything after that streams straight to the emitter.
+///
+/// For selective filters, the longest literal any matching row must contain is searched in the raw
+/// reader buffer first and only the rows around the hits get tokenized to confirm the column.
+///
+/// Example:
+/// ```zig
+/// var it = csvz.Iterator.init(&reader);
+/// var emitter = csvz.Emitter.init(&writer);
+/// var filter = csvz.Filter(.{}).init(allocator, &it, &.{
+///     .{ .column = 7, .match = .{ .contains = "timeout" } },
+/// }, .{ .header = true });
+/// defer filter.deinit();
+/// const stats = try filter.run(&emitter);
+/// ```
+pub fn Filter(comptime dialect: iterator.Dialect) type {
+    return struct {
+        allocator: Allocator,
+        iterator: *Iterator,
+        predicates: []const Predicate,
+        options: Options,
+        /// Once this column passes, the row is known to match.
+        last_predicate_column: usize,
+        /// Literal that every matching row contains in its raw bytes, if any.
+        needle: ?[]const u8,
+        staged: std.ArrayList(u8) = .empty,
+        staged_ends: std.ArrayList(usize) = .empty,
+
+        const Self = @This();
+        pub const Iterator = iterator.Csv(dialect);
+        pub const Options = FilterOptions;
+        pub const Stats = FilterStats;
+
+        /// Errors that can occur while filtering: any iterator error (other than EOF, which ends
+        /// the run), a failing writer or a failed staging allocation.
+        pub const Error = Iterator.Error || Writer.Error || Allocator.Error;
+
+        /// Initializes a filter reading from `it`.
+        ///
+        /// `predicates` must remain valid for the lifetime of the filter. An empty predicate list
+        /// matches every row.
+        pub fn init(allocator: Allocator, it: *Iterator, predicates: []const Predicate, options: Options) Self {
+            var last_column: usize = 0;
+            var needle: []const u8 = "";
+            for (predicates) |predicate| {
+                last_column = @max(last_column, predicate.column);
+                const literal = requiredLiteral(predicate.match);
+                // the raw bytes of a field hold escaped quotes (and escapes), so literals with them may not
+                // appear as is.
+                if (literal.len > needle.len and std.mem.indexOfScalar(u8, literal, it.quoteChar()) == null and
+                    (dialect.escape == null or std.mem.indexOfScalar(u8, literal, dialect.escape.?) == null))
+                {
+                    needle = literal;
+                }
+            }
+            return .{
+                .allocator = allocator,
+                .iterator = it,
+                .predicates = predicates,
+                .options = options,
+                .last_predicate_column = last_column,
+                .needle = if (options.prefilter and needle.len > 0) needle else null,
+            };
+        }
+
+        pub fn deinit(self: *Self) void {
+            self.staged.deinit(self.allocator);
+            self.staged_ends.deinit(self.allocator);
+        }
+
+        /// Filters all remaining rows, emitting the matching ones, until the end of the input.
+        pub fn run(self: *Self, emitter: *Emitter) Error!Stats {
+            var stats: Stats = .{};
+            if (self.options.header) {
+                self.copyRow(emitter) catch |err| switch (err) {
+                    error.EOF => return stats,
+                    else => |e| return e,
+                };
+            }
+
+            while (true) {
+                const matched = self.filterRow(emitter) catch |err| switch (err) {
+                    error.EOF => return stats,
+                    else => |e| return e,
+                };
+                stats.rows += 1;
+                stats.matched += @intFromBool(matched);
+            }
+        }
+
+        /// Reads one row, emitting it if it matches. Returns whether the row matched.
+        fn filterRow(self: *Self, emitter: *Emitter) Error!bool {
+            self.staged.clearRetainingCapacity();
+            self.staged_ends.clearRetainingCapacity();
+            if (self.needle) |needle| try self.iterator.skipRowsWithout(needle);
+
+            var column: usize = 0;
+            while (true) : (column += 1) {
+                var field = try self.iterator.next();
+                const value = field.unescaped();
+                if (!self.accepts(column, value)) {
+                    if (!field.last_column) try self.iterator.skipRow();
+                    return false;
+                }
+
+                if (column == self.last_predicate_column) {
+                    var start: usize = 0;
+                    for (self.staged_ends.items) |end| {
+                        try emitter.emit(self.staged.items[start..end]);
+                        start = end;
+                    }
+                    try emitter.emit(value);
+                    if (!field.last_column) try self.copyRemaining(emitter);
+                    emitter.next_row();
+                    return true;
+                }
+
+                // the row ended before reaching every predicate column.
+                if (field.last_column) return false;
+
+                try self.staged.appendSlice(self.allocator, value);
+                try self.staged_ends.append(self.allocator, self.staged.items.len);
+            }
+        }
+
+        inline fn accepts(self: *const Self, column: usize, value: []const u8) bool {
+            for (self.predicates) |*predicate| {
+                if (predicate.column == column and !predicate.matches(value)) return false;
+            }
+            return true;
+        }
+
+        fn copyRow(self: *Self, emitter: *Emitter) Error!void {
+            try self.copyRemaining(emitter);
+            emitter.next_row();
+        }
+
+        fn copyRemaining(self: *Self, emitter: *Emitter) Error!void {
+            while (true) {
+                var field = try self.iterator.next();
+                try emitter.emit(field.unescaped());
+                if (field.last_column) return;
+            }
+        }
+    };
+}
+
+/// Returns the longest literal a field must contain to satisfy `match`, or an empty slice.
+fn requiredLiteral(match: Predicate.Match) []const u8 {
+    return switch (match) {
+        .equals, .prefix, .contains => |literal| literal,
+        .pattern => |pattern| patternLiteral(pattern),
+        .range => "",
+    };
+}
+
+/// Returns the longest run of literal bytes in a regex-lite pattern, none of which are repeated by `*`.
+fn patternLiteral(pattern: []const u8) []const u8 {
+    var longest: []const u8 = "";
+    var start: usize = 0;
+    for (pattern, 0..) |byte, i| {
+        const anchor = (byte == '^' and i == 0) or (byte == '$' and i == pattern.len - 1);
+        const starred = i + 1 < pattern.len and pattern[i + 1] == '*';
+        if (byte == '.' or byte == '*' or anchor or starred) {
+            if (i - start > longest.len) longest = pattern[start..i];
+            start = i + 1;
+        }
+    }
+    if (pattern.len - start > longest.len) longest = pattern[start..];
+    return longest;
+}
+
+/// Matches `text` against a regex-lite `pattern` (see `Predicate.Match.pattern`).
+pub fn matchPattern(pattern: []const u8, text: []const u8) bool {
+    if (pattern.len > 0 and pattern[0] == '^') return matchHere(pattern[1..], text);
+    var i: usize = 0;
+    while (true) : (i += 1) {
+        if (matchHere(pattern, text[i..])) return true;
+        if (i == text.len) return false;
+    }
+}
+
+fn matchHere(pattern: []const u8, text: []const u8) bool {
+    if (pattern.len == 0) return true;
+    if (pattern.len >= 2 and pattern[1] == '*') return matchStar(pattern[0], pattern[2..], text);
+    if (pattern.len == 1 and pattern[0] == '$') return text.len == 0;
+    if (text.len > 0 and (pattern[0] == '.' or pattern[0] == text[0])) return matchHere(pattern[1..], text[1..]);
+    return false;
+}
+
+fn matchStar(item: u8, pattern: []const u8, text: []const u8) bool {
+    var i: usize = 0;
+    while (true) : (i += 1) {
+        if (matchHere(pattern, text[i..])) return true;
+        if (i == text.len or !(item == '.' or text[i] == item)) return false;
+    }
+}
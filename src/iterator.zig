@@ -1,5 +1,6 @@
 const std = @import("std");
 const simd = @import("simd.zig");
+const parallel = @import("parallel.zig");
 const Reader = std.Io.Reader;
 const Writer = std.Io.Writer;
 const Allocator = std.mem.Allocator;
@@ -12,20 +13,170 @@ const Allocator = std.mem.Allocator;
 /// Example:
 ///     const CustomIterator = Csv(.{.quote = '\'', .delimiter = ';'});
 pub const Dialect = struct {
-    /// Character used to quote fields containing special characters (default: '"')
-    quote: u8 = '"',
+    pub const Trim = enum { none, unquoted, all };
+
+    /// Character used to quote fields containing special characters (default: '"'). Set to null for data
+    /// that is never quoted (e.g. most TSV exports): quotes are then plain data, the scan only looks for the
+    /// delimiter and the terminator and the quoted field handling is not compiled in. A `runtime` dialect
+    /// with a null quote only accepts settings without a quote, and the other way around.
+    quote: ?u8 = '"',
     /// Character used to separate fields (default: ',')
     delimiter: u8 = ',',
-    /// SIMD vector length for optimized parsing. Set to null to disable SIMD.
-    /// By default, uses the optimal vector length for your platform.
+    /// SIMD vector length for optimized parsing. Set to null to disable SIMD, bytes are then classified 8 at
+    /// a time in a u64 (SWAR). By default, uses the optimal vector length for your platform.
     vector_length: ?comptime_int = simd.suggestVectorLength(),
+    /// Byte that ends a row (default: '\n'). Only with '\n' is a preceding '\r' trimmed, so that both LF
+    /// and CRLF rows are accepted. Use '\r' for CR-only line endings or 0x1E (ASCII record separator) for
+    /// record separated exports.
+    terminator: u8 = '\n',
+    /// Multi-byte field separator such as "||" or "::", `delimiter` is ignored when set. Only its first
+    /// byte takes part in the SIMD scan and candidates are confirmed by comparing the remaining bytes, so
+    /// the sequence should start with a byte that is rare in the data. Not supported by `runtime` dialects.
+    delimiter_sequence: ?[]const u8 = null,
+    /// When true, malformed quoting does not end the iteration. A quote inside an unquoted field is kept as
+    /// data, and a quoted field that is not closed properly (or does not fit the buffer) ends at the next
+    /// terminator: the rest of the row after the opening quote is returned as its last field. If that rest
+    /// does not fit the buffer either, it is skipped up to the next terminator and the last field is empty.
+    /// Every such error is recorded in the iterator's `errors` log. Well formed fields take the same path as
+    /// in strict mode.
+    lenient: bool = false,
+    /// When true, the iterator keeps the byte offset, row and column of the current field, see `position()`.
+    /// Rows and columns are advanced from the `last_column` flag of every returned field and offsets are
+    /// derived from the reader position, so the scan itself does no extra work. Always on for `lenient`
+    /// dialects.
+    track_position: bool = false,
+    /// When true, the scan runs in two stages: a tight SIMD loop first writes the positions of all quotes,
+    /// delimiters and terminators of a large part of the buffer (up to `structural_index_capacity`
+    /// positions) into an index, then fields are cut from that index. This keeps the per-field branches
+    /// out of the scanning loop, which pays off on data with many narrow columns. Requires `vector_length`.
+    structural_index: bool = false,
+    /// When true, the data promises that quoted fields never contain the terminator, so every terminator
+    /// ends a row. A quoted field still open at the end of its line fails with `InvalidQuotes` (or is
+    /// recovered from in `lenient` mode) instead of swallowing the following rows, and row boundaries are
+    /// found without tracking quotes: `skipRowsWithout` and the parallel helpers (`splitRows` with a null
+    /// quote, `aggregateParallel`, `profileParallel`) just look for the next terminator.
+    single_line_fields: bool = false,
+    /// Escape character inside quoted fields, e.g. '\\' for MySQL `SELECT ... INTO OUTFILE` exports. The
+    /// byte after an escape is always data: `\\"` is a quote and `\\\\` a backslash, doubled quotes are still
+    /// accepted. The escape is not part of the scan: a quote is escaped when an odd number of escapes
+    /// precede it, counted backwards from each quote from their bitmask (usually a single vector load).
+    /// Quoted fields without an escaped quote are searched once more for other escapes to set
+    /// `needs_unescape`, so escape dialects read quoted data twice. Fields are unescaped with
+    /// `unescapeEscapedInPlace` (`Field.unescaped()` does it for you), which drops the escapes and keeps
+    /// the bytes after them as they are. Requires a `quote`.
+    /// Escaped quotes break quote counting, so `skipRowsWithout`, `aggregateParallel` and `profileParallel`
+    /// find row boundaries by walking the rows forward with `parallel.RowWalker`.
+    escape: ?u8 = null,
+    /// Lines starting with this byte (e.g. '#') are skipped as a whole and never produce fields. Only the
+    /// first byte of a row is checked, the rest of the line is skipped with a `memchr` style search for the
+    /// terminator. Rows in `position()` still count the skipped lines. Quotes in comment lines are not
+    /// counted, so row boundaries are found with `parallel.RowWalker` like for `escape` dialects.
+    comment: ?u8 = null,
+    /// Spaces and tabs to trim around fields: `.unquoted` trims unquoted fields, `.all` also accepts blanks
+    /// around quoted fields (outside of the quotes, quoted data is kept as is). The blank runs are measured
+    /// from the bitmasks of the first and last vector of a field, so trimming never goes over the whole
+    /// field again. A delimiter that is a blank (e.g. tab) is never trimmed.
+    trim: Trim = .none,
+    /// When true, empty lines (a lone terminator, or "\r\n" when a '\r' is trimmed) are skipped instead of
+    /// being returned as a row with one empty field.
+    skip_empty_lines: bool = false,
+    /// When true, `quote`, `delimiter` and `terminator` are ignored and chosen at runtime with `initDialect()`
+    /// instead.
+    /// The SIMD masks are splatted once when the iterator is created, so scanning stays vectorized, at the
+    /// cost of keeping the masks and a byte class table in the iterator. Prefer a comptime dialect when the
+    /// dialect is known at compile time. Helpers that create their own iterators over raw data (e.g.
+    /// `aggregateParallel`) use the default quote and delimiter.
+    runtime: bool = false,
+};
+
+/// Number of positions a `structural_index` iterator collects per scan.
+pub const structural_index_capacity = 1024;
+
+/// Dialect settings for iterators of a `runtime` dialect.
+pub const RuntimeDialect = struct {
+    /// Quote character, null for data that is never quoted (requires a `runtime` dialect with a null quote).
+    quote: ?u8 = '"',
+    delimiter: u8 = ',',
+    /// Byte that ends a row, see `Dialect.terminator`.
+    terminator: u8 = '\n',
+    /// When true (the default), a `\r` before the `\n` that ends a row is dropped. Otherwise it is kept
+    /// as part of the last field, and a quoted last field must be followed by `\n` directly. Has no effect
+    /// unless `terminator` is `\n`.
+    trim_cr: bool = true,
+
+    /// Returns false if the quote, delimiter and terminator are not distinct or the quote or delimiter is
+    /// a line ending.
+    pub fn isValid(self: RuntimeDialect) bool {
+        if (self.delimiter == self.terminator or self.delimiter == '\n' or self.delimiter == '\r') return false;
+        if (self.quote) |quote| {
+            if (quote == self.delimiter or quote == self.terminator or quote == '\n' or quote == '\r') return false;
+        }
+        return true;
+    }
+};
+
+/// Position of the current field of an iterator, see `Dialect.track_position`.
+pub const Position = struct {
+    /// Byte offset of the start of the field, relative to the reader position the iterator was created at.
+    offset: u64,
+    /// Zero-based row and column of the field.
+    row: u64,
+    column: u64,
+};
+
+/// A malformed part of the input recovered from by a `lenient` iterator.
+pub const ParseError = struct {
+    pub const Kind = enum(c_int) {
+        /// A quote inside an unquoted field, kept as data.
+        bare_quote,
+        /// A closing quote followed by something else than a delimiter or terminator, or a quoted field
+        /// without closing quote at the end of the input.
+        invalid_quotes,
+        /// A quoted field that does not close within the reader buffer.
+        quoted_field_too_long,
+    };
+
+    kind: Kind,
+    /// Byte offset of the offending quote, relative to the reader position the iterator was created at.
+    offset: u64,
+    /// Zero-based row and column of the field.
+    row: u64,
+    column: u64,
+};
+
+/// Error side channel of `lenient` iterators: keeps the latest errors and calls an optional callback for
+/// every one of them.
+pub const ErrorLog = struct {
+    /// Number of errors kept, older ones are overwritten.
+    pub const capacity = 16;
+
+    entries: [capacity]ParseError = undefined,
+    /// Number of errors since the iterator was created, including overwritten ones.
+    count: u64 = 0,
+    /// Called with `context` for every error, e.g. to quarantine rows.
+    callback: ?*const fn (context: ?*anyopaque, err: ParseError) void = null,
+    context: ?*anyopaque = null,
+
+    /// Returns the error `back` errors before the most recent one, null if there is none or it was
+    /// overwritten.
+    pub fn latest(self: *const ErrorLog, back: usize) ?ParseError {
+        if (back >= self.count or back >= capacity) return null;
+        return self.entries[@intCast((self.count - 1 - back) % capacity)];
+    }
+
+    fn record(self: *ErrorLog, err: ParseError) void {
+        @branchHint(.cold);
+        self.entries[@intCast(self.count % capacity)] = err;
+        self.count += 1;
+        if (self.callback) |callback| callback(self.context, err);
+    }
 };
 
 /// Creates a CSV iterator type configured with the specified dialect.
 ///
 /// This is a compile-time function that returns a type specialized for itearting
 /// CSV fields according to the provided dialect configuration. The returned type
-/// includes SIMD optimizations when vector_length is set.
+/// includes SIMD optimizations when vector_length is set, and a SWAR scan otherwise.
 ///
 /// Basic usage:
 /// ```zig
@@ -46,28 +197,131 @@ pub fn Csv(comptime dialect: Dialect) type {
     return struct {
         reader: *std.Io.Reader,
         needs_unescape: bool = false,
-        quote_pending: bool = false,
-        vector: Bitmask = if (use_vectors) 0 else {},
+        /// bytes at the end of the buffer, starting at a closing quote, to scan again after a refill.
+        quote_pending: u32 = 0,
+        vector: if (use_vectors) Bitmask else void = if (use_vectors) 0 else {},
         vector_offset: if (use_vectors) usize else void = if (use_vectors) 0 else {},
+        /// pending positions of a `structural_index` dialect, used instead of `vector`.
+        index: if (dialect.structural_index) StructuralIndex else void = if (dialect.structural_index) .{} else {},
+        settings: Settings = if (dialect.runtime) .init(.{}) else {},
+        /// Errors recovered from by a `lenient` iterator.
+        errors: if (dialect.lenient) ErrorLog else void = if (dialect.lenient) .{} else {},
+        /// absolute offset of the start of the reader buffer (wrapping), kept up to date across refills.
+        base: if (tracks_position) u64 else void = if (tracks_position) 0 else {},
+        /// position of the next field, or of the field the last call to `next()` failed on.
+        offset: if (tracks_position) u64 else void = if (tracks_position) 0 else {},
+        row: if (tracks_position) u64 else void = if (tracks_position) 0 else {},
+        column: if (tracks_position) u64 else void = if (tracks_position) 0 else {},
+        /// set by `allowGrowth()`.
+        growth: ?Growth = null,
+        /// kind of the field whose partial chunk `nextChunk()` returned last.
+        chunk: ChunkState = .none,
+        /// whether the next field starts a row, i.e. lines may have to be skipped before it.
+        row_start: if (skips_lines) bool else void = if (skips_lines) true else {},
 
         const Self = @This();
+        /// The dialect this iterator was created with.
+        pub const config = dialect;
         const Newline = '\n';
         const CarriageReturn = '\r';
+        /// first byte of the delimiter, the only one the scan looks for.
+        const Delimiter = if (dialect.delimiter_sequence) |sequence| sequence[0] else dialect.delimiter;
+        /// remaining bytes of a multi-byte delimiter.
+        const delimiter_tail: []const u8 = if (dialect.delimiter_sequence) |sequence| sequence[1..] else "";
+
+        /// bytes classified at once: a SIMD vector, or a u64 word without SIMD.
+        const scan_length = dialect.vector_length orelse 8;
+        const use_swar = dialect.vector_length == null;
+        const Bitmask = std.meta.Int(.unsigned, scan_length);
+        const Vector = if (use_swar) [8]u8 else @Vector(scan_length, u8);
+
+        /// whether quoted fields are handled at all, see `Dialect.quote`.
+        const has_quotes = dialect.quote != null;
+        /// quote character reported for unescaping, meaningless without quotes since nothing is escaped.
+        const Quote = dialect.quote orelse '"';
+
+        const QuoteMask: Vector = @splat(Quote);
+        const DelimiterMask: Vector = @splat(Delimiter);
+        const TerminatorMask: Vector = @splat(dialect.terminator);
+        /// bytes trimmed by `Dialect.trim`.
+        const blanks = " \t";
 
-        const Bitmask = if (dialect.vector_length) |len| std.meta.Int(.unsigned, len) else void;
-        const Vector = if (dialect.vector_length) |len| @Vector(len, u8) else void;
+        /// whether the pending positions of the last classified block are kept in `vector`.
+        const use_vectors = !dialect.structural_index;
+        /// Whether `position()` is available.
+        pub const tracks_position = dialect.lenient or dialect.track_position;
+        /// whether lines are skipped at the start of a row, see `skipLines`.
+        const skips_lines = dialect.comment != null or dialect.skip_empty_lines;
 
-        const QuoteMask: Vector = @splat(dialect.quote);
-        const DelimiterMask: Vector = @splat(dialect.delimiter);
-        const NewLineMask: Vector = @splat(Newline);
+        comptime {
+            if (dialect.delimiter_sequence) |sequence| {
+                if (sequence.len == 0) @compileError("delimiter_sequence must not be empty");
+                if (dialect.runtime) @compileError("delimiter_sequence is not supported by runtime dialects");
+                for (delimiter_tail) |byte| {
+                    if (byte == dialect.terminator or (has_quotes and byte == Quote))
+                        @compileError("delimiter_sequence must not contain the quote or the terminator");
+                }
+            }
+            if (!dialect.runtime and (Delimiter == dialect.terminator or
+                (has_quotes and (Quote == Delimiter or Quote == dialect.terminator))))
+                @compileError("quote, delimiter and terminator must be distinct");
+            if (dialect.comment) |comment| {
+                if ((has_quotes and comment == Quote) or comment == Delimiter or comment == dialect.terminator)
+                    @compileError("comment must differ from the quote, delimiter and terminator");
+            }
+            if (dialect.escape) |escape| {
+                if (!has_quotes) @compileError("escape requires a quote");
+                if (escape == Quote or escape == Delimiter or escape == dialect.terminator or escape == CarriageReturn)
+                    @compileError("escape must differ from the quote, delimiter and terminator");
+            }
+            if (dialect.structural_index and dialect.vector_length == null)
+                @compileError("structural_index requires a vector_length");
+        }
+
+        const StructuralIndex = struct {
+            /// positions relative to `start`, with room for the unconditional writes of `buildIndex`.
+            positions: [structural_index_capacity + index_unroll]u32 = undefined,
+            start: usize = 0,
+            head: usize = 0,
+            len: usize = 0,
+        };
+        const index_unroll = 4;
 
-        const use_vectors = dialect.vector_length != null;
+        /// quote, delimiter and the matching SIMD masks of a runtime dialect.
+        const Settings = if (dialect.runtime) struct {
+            quote: u8,
+            delimiter: u8,
+            terminator: u8,
+            trim_cr: bool,
+            quote_mask: if (use_swar or !has_quotes) void else Vector,
+            delimiter_mask: if (use_swar) void else Vector,
+            terminator_mask: if (use_swar) void else Vector,
+            is_delim: [256]bool,
+
+            fn init(runtime: RuntimeDialect) @This() {
+                const quote = runtime.quote orelse Quote;
+                var is_delim_table = [_]bool{false} ** 256;
+                is_delim_table[runtime.delimiter] = true;
+                if (has_quotes) is_delim_table[quote] = true;
+                is_delim_table[runtime.terminator] = true;
+                return .{
+                    .quote = quote,
+                    .delimiter = runtime.delimiter,
+                    .terminator = runtime.terminator,
+                    .trim_cr = runtime.trim_cr and runtime.terminator == Newline,
+                    .quote_mask = if (use_swar or !has_quotes) {} else @splat(quote),
+                    .delimiter_mask = if (use_swar) {} else @splat(runtime.delimiter),
+                    .terminator_mask = if (use_swar) {} else @splat(runtime.terminator),
+                    .is_delim = is_delim_table,
+                };
+            }
+        } else void;
 
         const is_delim = blk: {
             var t = [_]bool{false} ** 256;
-            t[dialect.delimiter] = true;
-            t[dialect.quote] = true;
-            t[Newline] = true;
+            t[Delimiter] = true;
+            if (has_quotes) t[Quote] = true;
+            t[dialect.terminator] = true;
             break :blk t;
         };
 
@@ -79,6 +333,17 @@ pub fn Csv(comptime dialect: Dialect) type {
         /// - EOF: Reached the end of the CSV file (not an error condition in normal use)
         pub const Error = error{ ReadFailed, InvalidQuotes, FieldTooLong, EOF };
 
+        const Growth = struct {
+            allocator: Allocator,
+            max_len: usize,
+            /// the reader's own buffer, restored once the buffered data fits in it again.
+            original: []u8,
+            /// larger buffer currently used by the reader, if any.
+            owned: ?[]u8 = null,
+        };
+
+        const ChunkState = enum { none, unquoted, quoted, row };
+
         const QuotedRegion = struct {
             /// position of the matching quote character in the buffer.
             end: usize,
@@ -105,6 +370,15 @@ pub fn Csv(comptime dialect: Dialect) type {
             /// True if the field contains escaped double quotes (e.g., `""` for `"`).
             /// When true, call `unescaped()` to remove the escape characters.
             needs_unescape: bool = false,
+            /// True if this is a chunk of a larger field that continues in the next chunk, see `nextChunk()`.
+            partial: bool = false,
+            /// Quote character of a `runtime` dialect, see `quoteChar()`.
+            quote: if (dialect.runtime) u8 else void = if (dialect.runtime) '"' else {},
+
+            /// Returns the quote character used to escape quotes in `data`.
+            pub fn quoteChar(self: *const Field) u8 {
+                return if (dialect.runtime) self.quote else Quote;
+            }
 
             /// Compares two fields for equality based on data, last_column, and needs_unescape.
             pub fn eql(self: *const Field, other: Field) bool {
@@ -123,7 +397,10 @@ pub fn Csv(comptime dialect: Dialect) type {
             pub fn unescaped(self: *Field) []u8 {
                 if (self.needs_unescape) {
                     self.needs_unescape = false;
-                    self.data = unescapeInPlace(dialect.quote, self.data);
+                    self.data = if (dialect.escape) |escape|
+                        unescapeEscapedInPlace(self.quoteChar(), escape, self.data)
+                    else
+                        unescapeInPlace(self.quoteChar(), self.data);
                     return self.data;
                 }
 
@@ -152,7 +429,123 @@ pub fn Csv(comptime dialect: Dialect) type {
         /// var it = Iterator.init(&reader);
         /// ```
         pub fn init(reader: *std.Io.Reader) Self {
-            return .{ .reader = reader };
+            var self: Self = .{ .reader = reader };
+            if (tracks_position) self.base = 0 -% @as(u64, reader.seek);
+            return self;
+        }
+
+        /// Initializes an iterator of a `runtime` dialect with the given quote, delimiter, terminator and CR
+        /// handling.
+        ///
+        /// Example:
+        /// ```zig
+        /// var it = try Csv(.{ .runtime = true }).initDialect(&reader, .{ .delimiter = ':' });
+        /// ```
+        pub fn initDialect(reader: *std.Io.Reader, runtime: RuntimeDialect) error{InvalidDialect}!Self {
+            if (!dialect.runtime) @compileError("initDialect requires a runtime dialect");
+            if (!runtime.isValid() or (runtime.quote != null) != has_quotes) return error.InvalidDialect;
+            if (dialect.escape) |escape| {
+                if (escape == runtime.quote.? or escape == runtime.delimiter or escape == runtime.terminator)
+                    return error.InvalidDialect;
+            }
+            var self = init(reader);
+            self.settings = .init(runtime);
+            return self;
+        }
+
+        /// Lets the iterator replace the reader buffer with a larger one when a field does not fit, instead of
+        /// failing with `FieldTooLong`. The buffer is allocated with `allocator`, doubles every time up to
+        /// `max_len` bytes and is given up for the reader's own buffer as soon as the buffered data fits in
+        /// half of it again. Inputs without oversized fields never allocate, a failed allocation is reported
+        /// as `FieldTooLong`. Call `deinit()` once done.
+        ///
+        /// Example:
+        /// ```zig
+        /// var it = Iterator.init(&reader.interface); // e.g. with a 64KiB buffer
+        /// it.allowGrowth(allocator, 16 * 1024 * 1024);
+        /// defer it.deinit();
+        /// ```
+        pub fn allowGrowth(self: *Self, allocator: Allocator, max_len: usize) void {
+            self.growth = .{ .allocator = allocator, .max_len = max_len, .original = self.reader.buffer };
+        }
+
+        /// Frees the buffer allocated after `allowGrowth()` and hands the reader its own buffer back. Buffered
+        /// data that does not fit in it is dropped.
+        pub fn deinit(self: *Self) void {
+            if (self.growth) |*growth| {
+                if (growth.owned) |owned| {
+                    const r = self.reader;
+                    if (r.end - r.seek > growth.original.len) r.seek = r.end;
+                    self.relocate(growth.original);
+                    growth.allocator.free(owned);
+                }
+            }
+            self.growth = null;
+        }
+
+        /// replaces a full reader buffer with one twice as large, returns false if it cannot grow.
+        fn grow(self: *Self) bool {
+            @branchHint(.cold);
+            if (self.growth) |*growth| {
+                const len = self.reader.buffer.len;
+                if (len >= growth.max_len) return false;
+                const buffer = growth.allocator.alloc(u8, @min(growth.max_len, @max(2 * len, 64))) catch return false;
+                self.relocate(buffer);
+                if (growth.owned) |owned| growth.allocator.free(owned);
+                growth.owned = buffer;
+                return true;
+            }
+            return false;
+        }
+
+        /// goes back to the reader's own buffer once the buffered data fits in half of it.
+        fn shrink(self: *Self, growth: *Growth) void {
+            const owned = growth.owned orelse return;
+            if (self.reader.end - self.reader.seek > growth.original.len / 2) return;
+            self.relocate(growth.original);
+            growth.allocator.free(owned);
+            growth.owned = null;
+        }
+
+        /// moves the buffered data to the start of `buffer` and makes it the reader buffer.
+        fn relocate(self: *Self, buffer: []u8) void {
+            const r = self.reader;
+            const data = r.buffer[r.seek..r.end];
+            @memcpy(buffer[0..data.len], data);
+            if (tracks_position) self.base +%= r.seek;
+            self.resetScan();
+            r.buffer = buffer;
+            r.seek = 0;
+            r.end = data.len;
+        }
+
+        /// Returns the quote character of this iterator ('"' for a dialect without quotes).
+        pub inline fn quoteChar(self: *const Self) u8 {
+            return if (dialect.runtime) self.settings.quote else Quote;
+        }
+
+        /// Returns the delimiter of this iterator (the first byte of a `delimiter_sequence`).
+        pub inline fn delimiterChar(self: *const Self) u8 {
+            return if (dialect.runtime) self.settings.delimiter else Delimiter;
+        }
+
+        /// Returns the byte that ends a row.
+        pub inline fn terminatorChar(self: *const Self) u8 {
+            return if (dialect.runtime) self.settings.terminator else dialect.terminator;
+        }
+
+        inline fn trimsCarriageReturn(self: *const Self) bool {
+            return if (dialect.runtime) self.settings.trim_cr else dialect.terminator == Newline;
+        }
+
+        /// Matches the rest of a multi-byte delimiter whose first byte is at `pos`. Returns null if the
+        /// buffer ends with a prefix of it, so the match can only be decided after a refill.
+        inline fn delimiterAt(self: *const Self, pos: usize) ?bool {
+            const rest = self.reader.buffer[pos + 1 .. self.reader.end];
+            if (rest.len < delimiter_tail.len) {
+                return if (std.mem.startsWith(u8, delimiter_tail, rest)) null else false;
+            }
+            return std.mem.eql(u8, rest[0..delimiter_tail.len], delimiter_tail);
         }
 
         /// finds the end of the quoted region (assuming the first double quote is alerady consumed).
@@ -160,51 +553,67 @@ pub fn Csv(comptime dialect: Dialect) type {
         /// quote is the very last character in the buffer and in the file, then it needs to be handled outside of this
         /// function.
         inline fn findQuotedRegion(self: *Self, start_index: usize) Error!?QuotedRegion {
-            var i = start_index - @intFromBool(self.quote_pending);
-            self.quote_pending = false;
+            var i = start_index - self.quote_pending;
+            self.quote_pending = 0;
             const data = self.reader.buffer[0..self.reader.end];
             var r = self.reader;
 
             while (self.nextDelimPos(i)) |idx| {
-                if (data[idx] == dialect.quote) {
+                if (data[idx] == self.quoteChar()) {
+                    if (dialect.escape != null and escapeRun(data[r.seek..idx]) % 2 == 1) {
+                        self.needs_unescape = true;
+                        i = idx + 1;
+                        continue;
+                    }
                     if (idx + 1 == data.len) {
                         @branchHint(.unlikely);
-                        self.quote_pending = true;
-                        return null;
+                        return self.pendingQuote(idx);
                     }
 
-                    switch (data[idx + 1]) {
-                        dialect.quote => {
-                            self.needs_unescape = true;
-                            self.skipNextDelim();
-                            i = idx + 2;
-                        },
-                        dialect.delimiter => {
-                            self.skipNextDelim();
-                            r.toss(1 + 1 + idx - r.seek); // toss ',' in addition to "
-                            return .{ .end = idx, .last_column = false };
-                        },
-                        Newline => {
-                            self.skipNextDelim();
-                            r.toss(1 + 1 + idx - r.seek); // toss '\n' in addition to "
-                            return .{ .end = idx, .last_column = true };
-                        },
-                        CarriageReturn => {
-                            if (idx + 2 == data.len) {
-                                @branchHint(.unlikely);
-                                self.quote_pending = true;
-                                return null;
+                    // position of the byte that decides how the quoted region ends.
+                    const after_pos = if (dialect.trim == .all) self.skipBlanks(data, idx + 1) else idx + 1;
+                    if (dialect.trim == .all and after_pos == data.len) return self.pendingQuote(idx);
+                    const after = data[after_pos];
+                    if (after == self.quoteChar() and after_pos == idx + 1) {
+                        self.needs_unescape = true;
+                        self.skipNextDelim();
+                        i = idx + 2;
+                    } else if (after == self.delimiterChar()) {
+                        if (delimiter_tail.len > 0) {
+                            const complete = self.delimiterAt(after_pos) orelse return self.pendingQuote(idx);
+                            if (!complete) {
+                                @branchHint(.cold);
+                                return error.InvalidQuotes;
                             }
-                            self.skipNextDelim();
-                            r.toss(2 + 1 + idx - r.seek); // toss '\r' and '\n' in addition to "
-                            return .{ .end = idx, .last_column = true };
-                        },
-                        else => {
+                        }
+                        if (delimiter_tail.len > 0) self.skipUntil(after_pos + 1 + delimiter_tail.len) else self.skipNextDelim();
+                        r.toss(after_pos + 1 + delimiter_tail.len - r.seek); // toss ',' in addition to "
+                        return .{ .end = idx, .last_column = false };
+                    } else if (after == self.terminatorChar()) {
+                        self.skipNextDelim();
+                        r.toss(after_pos + 1 - r.seek); // toss '\n' in addition to "
+                        return .{ .end = idx, .last_column = true };
+                    } else if (after == CarriageReturn and self.trimsCarriageReturn()) {
+                        if (after_pos + 1 == data.len) {
+                            @branchHint(.unlikely);
+                            return self.pendingQuote(idx);
+                        }
+                        if (data[after_pos + 1] != Newline) {
                             @branchHint(.cold);
                             return error.InvalidQuotes;
-                        },
+                        }
+                        self.skipNextDelim();
+                        r.toss(after_pos + 2 - r.seek); // toss '\r' and '\n' in addition to "
+                        return .{ .end = idx, .last_column = true };
+                    } else {
+                        @branchHint(.cold);
+                        return error.InvalidQuotes;
                     }
                 } else {
+                    if (dialect.single_line_fields and data[idx] == self.terminatorChar()) {
+                        @branchHint(.cold);
+                        return error.InvalidQuotes;
+                    }
                     if (idx + 1 == data.len) {
                         @branchHint(.unlikely);
                         return null;
@@ -216,8 +625,89 @@ pub fn Csv(comptime dialect: Dialect) type {
             return null;
         }
 
-        fn nextQuotedRegion(self: *Self) Error!Field {
+        /// defers the closing quote candidate at `pos` until more data is buffered.
+        inline fn pendingQuote(self: *Self, pos: usize) ?QuotedRegion {
+            self.quote_pending = @intCast(self.reader.end - pos);
+            self.resetScan();
+            return null;
+        }
+
+        /// number of escape bytes at the end of `data`.
+        fn escapeRun(data: []const u8) usize {
+            return runLength(data, &.{dialect.escape.?}, .trailing);
+        }
+
+        /// bitmask of the bytes of `block` equal to one of `bytes`.
+        inline fn matchBits(block: Vector, comptime bytes: []const u8) Bitmask {
+            if (use_swar) return simd.swarMatch(block, bytes);
+            var bits: Bitmask = 0;
+            inline for (bytes) |byte| bits |= @as(Bitmask, @bitCast(block == @as(Vector, @splat(byte))));
+            return bits;
+        }
+
+        /// number of bytes at the start or the end of `data` equal to one of `bytes`, counted a vector at a
+        /// time from their bitmask: the first byte of a vector is its lowest bit, so the run at the start is
+        /// the trailing ones of the mask and the run at the end its leading ones.
+        fn runLength(data: []const u8, comptime bytes: []const u8, comptime side: enum { leading, trailing }) usize {
+            var run: usize = 0;
+            while (data.len - run >= scan_length) {
+                const offset = if (side == .leading) run else data.len - run - scan_length;
+                const bits = matchBits(data[offset..][0..scan_length].*, bytes);
+                const count: usize = if (side == .leading) @ctz(~bits) else @clz(~bits);
+                run += count;
+                if (count < scan_length) return run;
+            }
+            while (run < data.len) : (run += 1) {
+                const byte = if (side == .leading) data[run] else data[data.len - 1 - run];
+                if (std.mem.indexOfScalar(u8, bytes, byte) == null) break;
+            }
+            return run;
+        }
+
+        /// `data` of an unquoted field without the blanks around it, see `Dialect.trim`. Only the end is
+        /// trimmed unless `leading`, i.e. for the last chunk of a field returned in chunks.
+        inline fn trimmed(data: []u8, leading: bool) []u8 {
+            if (dialect.trim == .none) return data;
+            const end = data.len - runLength(data, blanks, .trailing);
+            const start = if (leading) runLength(data[0..end], blanks, .leading) else 0;
+            return data[start..end];
+        }
+
+        /// returns the position of the first byte at or after `pos` that is not a blank after a closing quote,
+        /// a blank delimiter is not skipped.
+        inline fn skipBlanks(self: *const Self, data: []const u8, pos: usize) usize {
+            var i = pos;
+            while (i < data.len and (data[i] == ' ' or data[i] == '\t') and data[i] != self.delimiterChar()) i += 1;
+            return i;
+        }
+
+        /// starts the quoted field whose opening quote is at `quote_pos`, blanks before it are skipped if
+        /// quoted fields are trimmed.
+        inline fn nextQuotedFieldTrimmed(self: *Self, seek: usize, quote_pos: usize, comptime chunked: bool) Error!Field {
+            if (dialect.trim == .all and quote_pos != seek and
+                runLength(self.reader.buffer[seek..quote_pos], blanks, .leading) == quote_pos - seek)
+            {
+                self.reader.toss(quote_pos - seek);
+                return self.nextQuotedField(quote_pos, quote_pos, chunked);
+            }
+            return self.nextQuotedField(seek, quote_pos, chunked);
+        }
+
+        /// whether the quoted field `data` has to be unescaped: `needs_unescape` only tracks escaped quotes,
+        /// other escaped bytes are found with one more search.
+        inline fn quotedNeedsUnescape(self: *const Self, data: []const u8) bool {
+            if (dialect.escape) |escape| return self.needs_unescape or std.mem.indexOfScalar(u8, data, escape) != null;
+            return self.needs_unescape;
+        }
+
+        fn nextQuotedRegion(self: *Self, comptime chunked: bool) Error!Field {
             self.reader.toss(1);
+            return self.continueQuotedRegion(chunked);
+        }
+
+        /// scans the quoted region starting at the reader seek, right after its opening quote or the last
+        /// partial chunk.
+        fn continueQuotedRegion(self: *Self, comptime chunked: bool) Error!Field {
             self.needs_unescape = false;
             var r = self.reader;
             {
@@ -226,15 +716,24 @@ pub fn Csv(comptime dialect: Dialect) type {
                     return .{
                         .data = r.buffer[seek..region.end],
                         .last_column = region.last_column,
-                        .needs_unescape = self.needs_unescape,
+                        .needs_unescape = self.quotedNeedsUnescape(r.buffer[seek..region.end]),
                     };
                 }
             }
 
             while (true) {
                 const content_len = r.end - r.seek;
-                if (r.buffer.len - content_len == 0) break;
-                Reader.fillMore(r) catch |e| switch (e) {
+                if (r.buffer.len - content_len == 0 and !self.grow()) {
+                    if (chunked) {
+                        var keep: usize = self.quote_pending;
+                        self.quote_pending = 0;
+                        // an escape whose byte is not buffered yet goes to the next chunk with it.
+                        if (dialect.escape != null and keep == 0 and escapeRun(r.buffered()) % 2 == 1) keep = 1;
+                        return self.partialChunk(keep, .quoted);
+                    }
+                    break;
+                }
+                self.fill() catch |e| switch (e) {
                     Reader.Error.EndOfStream => {
                         const remaining = r.buffered();
                         if (remaining.len == 0) return Error.InvalidQuotes;
@@ -243,23 +742,26 @@ pub fn Csv(comptime dialect: Dialect) type {
                             return .{
                                 .data = r.buffer[seek..region.end],
                                 .last_column = region.last_column,
-                                .needs_unescape = self.needs_unescape,
+                                .needs_unescape = self.quotedNeedsUnescape(r.buffer[seek..region.end]),
                             };
                         }
                         r.toss(remaining.len);
                         var end = remaining.len - 1;
-                        if (end > 0 and remaining[end] == Newline) end -= 1;
-                        if (end > 0 and remaining[end] == CarriageReturn) end -= 1;
+                        if (end > 0 and remaining[end] == self.terminatorChar()) end -= 1;
+                        if (end > 0 and remaining[end] == CarriageReturn and self.trimsCarriageReturn()) end -= 1;
+                        if (dialect.trim == .all) end -= @min(end, runLength(remaining[0 .. end + 1], blanks, .trailing));
                         // NB: findQuotedRegion only returns if after the double quote is another character.
                         // if it does not return, it means the remaining buffer MUST end with a double quote.
-                        if (remaining[end] != dialect.quote) {
+                        if (remaining[end] != self.quoteChar() or
+                            (dialect.escape != null and escapeRun(remaining[0..end]) % 2 == 1))
+                        {
                             @branchHint(.unlikely);
                             return Error.InvalidQuotes;
                         }
                         return .{
                             .data = remaining[0..end],
                             .last_column = true,
-                            .needs_unescape = self.needs_unescape,
+                            .needs_unescape = self.quotedNeedsUnescape(remaining[0..end]),
                         };
                     },
                     else => |err| return err,
@@ -269,7 +771,7 @@ pub fn Csv(comptime dialect: Dialect) type {
                     return .{
                         .data = r.buffer[seek..region.end],
                         .last_column = region.last_column,
-                        .needs_unescape = self.needs_unescape,
+                        .needs_unescape = self.quotedNeedsUnescape(r.buffer[seek..region.end]),
                     };
                 }
             }
@@ -284,25 +786,162 @@ pub fn Csv(comptime dialect: Dialect) type {
                     var remaining = r.buffered();
                     if (remaining.len == 0) return Error.InvalidQuotes;
                     r.toss(remaining.len);
-                    if (remaining[remaining.len - 1] != dialect.quote) return Error.InvalidQuotes;
+                    if (dialect.trim == .all) remaining.len -= @min(remaining.len - 1, runLength(remaining, blanks, .trailing));
+                    if (remaining[remaining.len - 1] != self.quoteChar()) return Error.InvalidQuotes;
                     remaining.len -= 1;
+                    if (dialect.escape != null and escapeRun(remaining) % 2 == 1) return Error.InvalidQuotes;
                     return .{
                         .data = remaining,
                         .last_column = true,
-                        .needs_unescape = self.needs_unescape,
+                        .needs_unescape = self.quotedNeedsUnescape(remaining),
                     };
                 },
             }
         }
 
+        /// continues with the quoted region whose opening quote is at `quote_pos`, or handles a quote in the
+        /// middle of an unquoted field starting at `seek` in lenient mode.
+        inline fn nextQuotedField(self: *Self, seek: usize, quote_pos: usize, comptime chunked: bool) Error!Field {
+            if (!dialect.lenient) return self.nextQuotedRegion(chunked);
+            if (quote_pos != seek) {
+                self.recordError(.bare_quote, self.base +% quote_pos);
+                return self.nextLiteralField(quote_pos + 1, .field, chunked);
+            }
+
+            const start = self.base +% (seek + 1);
+            return self.nextQuotedRegion(chunked) catch |err| return self.recoverQuoted(err, start, start -% 1, chunked);
+        }
+
+        /// continues a quoted field after a partial chunk.
+        fn nextQuotedChunk(self: *Self) Error!Field {
+            if (!dialect.lenient) return self.continueQuotedRegion(true);
+            const start = self.base +% self.reader.seek;
+            return self.continueQuotedRegion(true) catch |err| return self.recoverQuoted(err, start, start, true);
+        }
+
+        /// lenient mode: records a malformed quoted region at `error_offset` and returns the rest of the row
+        /// from `start`. Both are absolute offsets and the data from `start` is never discarded before the
+        /// field is returned.
+        fn recoverQuoted(self: *Self, err: Error, start: u64, error_offset: u64, comptime chunked: bool) Error!Field {
+            const kind: ParseError.Kind = switch (err) {
+                error.InvalidQuotes => .invalid_quotes,
+                error.FieldTooLong => .quoted_field_too_long,
+                else => |e| return e,
+            };
+            self.reader.seek = @intCast(start -% self.base);
+            self.recordError(kind, error_offset);
+            self.quote_pending = 0;
+            self.resetScan();
+            return self.nextLiteralField(self.reader.seek, .row, chunked);
+        }
+
+        /// ends the unquoted field starting at the reader seek at the first delimiter or terminator (`.field`)
+        /// or terminator (`.row`) at or after `from`. Quotes are data in lenient mode and invalid otherwise.
+        fn nextLiteralField(self: *Self, from: usize, comptime until: enum { field, row }, comptime chunked: bool) Error!Field {
+            @branchHint(.cold);
+            const r = self.reader;
+            var i = from;
+            var rescan: usize = 0;
+            while (true) {
+                while (self.nextBoundaryPos(i, &rescan)) |end| {
+                    const delim = r.buffer[end];
+                    if (!has_quotes or delim != self.quoteChar()) {
+                        if (until == .field or delim == self.terminatorChar()) return self.handleBoundary(delim, r.seek, end);
+                    } else if (until == .field and !dialect.lenient) return error.InvalidQuotes;
+                    i = end + 1;
+                }
+                const content_len = r.end - r.seek;
+                if (r.buffer.len - content_len == 0 and !self.grow()) {
+                    if (chunked) return self.partialChunk(rescan, if (until == .field) .unquoted else .row);
+                    if (dialect.lenient and until == .row and r.buffer.len > 0) return self.dropRow();
+                    break;
+                }
+                self.fill() catch |e| switch (e) {
+                    Reader.Error.EndOfStream => {
+                        const remaining = r.buffered();
+                        r.toss(remaining.len);
+                        return .{ .data = trimmed(remaining, self.chunk == .none), .last_column = true };
+                    },
+                    else => |err| return err,
+                };
+                i = r.seek + content_len - rescan;
+            }
+
+            var failing_writer = Writer.failing;
+            while (r.vtable.stream(r, &failing_writer, .limited(1))) |n| {
+                std.debug.assert(n == 0);
+            } else |err| switch (err) {
+                error.WriteFailed => return Error.FieldTooLong,
+                error.ReadFailed => |e| return e,
+                error.EndOfStream => {
+                    const remaining = r.buffered();
+                    r.toss(remaining.len);
+                    return .{ .data = trimmed(remaining, self.chunk == .none), .last_column = true };
+                },
+            }
+        }
+
+        /// lenient mode: drops the rest of a recovered row that does not fit the buffer, up to and including
+        /// its terminator, and returns it as an empty last field. The error is already recorded.
+        fn dropRow(self: *Self) Error!Field {
+            @branchHint(.cold);
+            const r = self.reader;
+            while (true) {
+                if (std.mem.indexOfScalar(u8, r.buffered(), self.terminatorChar())) |end| {
+                    r.toss(end + 1);
+                    break;
+                }
+                r.toss(r.end - r.seek);
+                self.resetScan();
+                self.fill() catch |err| switch (err) {
+                    error.EndOfStream => break,
+                    else => |e| return e,
+                };
+            }
+            self.resetScan();
+            return .{ .data = r.buffer[r.seek..r.seek], .last_column = true };
+        }
+
+        fn recordError(self: *Self, kind: ParseError.Kind, offset: u64) void {
+            self.errors.record(.{ .kind = kind, .offset = offset, .row = self.row, .column = self.column });
+        }
+
+        /// returns the buffered part of an oversized field as a partial chunk, except for the last `keep`
+        /// bytes that decide how the field continues.
+        fn partialChunk(self: *Self, keep: usize, state: ChunkState) Field {
+            const r = self.reader;
+            var end = r.end - keep;
+            // a trailing '\r' is trimmed if the '\n' after it ends the row.
+            if (state != .quoted and self.trimsCarriageReturn() and end > r.seek and r.buffer[end - 1] == CarriageReturn) end -= 1;
+            if (dialect.trim != .none and state != .quoted) {
+                // trailing blanks go to the next chunk, they are only trimmed if the field ends there.
+                const tail = runLength(r.buffer[r.seek..end], blanks, .trailing);
+                if (tail < end - r.seek) end -= tail;
+                if (self.chunk == .none) r.toss(runLength(r.buffer[r.seek..end], blanks, .leading));
+            }
+            const data = r.buffer[r.seek..end];
+            r.toss(data.len);
+            self.resetScan();
+            self.chunk = state;
+            return .{
+                .data = data,
+                .last_column = false,
+                .needs_unescape = state == .quoted and self.quotedNeedsUnescape(data),
+                .partial = true,
+            };
+        }
+
         inline fn handleBoundary(self: *Self, delim: u8, seek: usize, end: usize) Error!Field {
-            const prev_is_cr = @intFromBool((end != 0) and (self.reader.buffer[end - 1] == CarriageReturn));
-            const is_newline = @intFromBool(delim == Newline);
+            const prev_is_cr = @intFromBool(self.trimsCarriageReturn() and (end != 0) and (self.reader.buffer[end - 1] == CarriageReturn));
+            const is_newline = @intFromBool(delim == self.terminatorChar());
             const trim_cr = prev_is_cr & is_newline;
 
-            self.reader.toss(1 + end - seek);
+            if (delimiter_tail.len > 0 and is_newline == 0) {
+                self.skipUntil(end + 1 + delimiter_tail.len);
+                self.reader.toss(1 + delimiter_tail.len + end - seek);
+            } else self.reader.toss(1 + end - seek);
             return .{
-                .data = self.reader.buffer[seek .. end - trim_cr],
+                .data = trimmed(self.reader.buffer[seek .. end - trim_cr], self.chunk == .none),
                 .last_column = is_newline != 0,
             };
         }
@@ -337,13 +976,80 @@ pub fn Csv(comptime dialect: Dialect) type {
         /// }
         /// ```
         pub fn next(self: *Self) Error!Field {
+            if (skips_lines and self.row_start) try self.skipLines();
+            if (tracks_position) self.offset = self.base +% self.reader.seek;
+            var field = try self.nextField(false);
+            if (dialect.runtime) field.quote = self.settings.quote;
+            if (skips_lines) self.row_start = field.last_column;
+            if (tracks_position) {
+                self.offset = self.base +% self.reader.seek;
+                self.row += @intFromBool(field.last_column);
+                self.column = if (field.last_column) 0 else self.column + 1;
+            }
+            return field;
+        }
+
+        /// Same as `next()`, but a field that does not fit in the reader buffer (or in the `allowGrowth()` cap)
+        /// is returned in chunks instead of failing with `FieldTooLong`. Every chunk but the last one of a
+        /// field has `partial` set, `last_column` is only meaningful on the last one. Escaped quotes never
+        /// span two chunks, so each chunk can be unescaped on its own. Memory use stays bounded by the
+        /// buffer no matter how large a field is.
+        ///
+        /// Fields that fit are returned whole, exactly like `next()`. Once a partial chunk is returned, keep
+        /// calling `nextChunk()` up to the last chunk of the field.
+        ///
+        /// Example streaming a large column:
+        /// ```zig
+        /// while (true) {
+        ///     var chunk = it.nextChunk() catch |err| switch (err) {
+        ///         error.EOF => break,
+        ///         else => |e| return e,
+        ///     };
+        ///     try out.writeAll(chunk.unescaped());
+        ///     if (!chunk.partial) try out.writeByte(if (chunk.last_column) '\n' else ',');
+        /// }
+        /// ```
+        pub fn nextChunk(self: *Self) Error!Field {
+            if (skips_lines and self.chunk == .none and self.row_start) try self.skipLines();
+            if (tracks_position and self.chunk == .none) self.offset = self.base +% self.reader.seek;
+            var field = try switch (self.chunk) {
+                .none => self.nextField(true),
+                .unquoted => self.nextLiteralField(self.reader.seek, .field, true),
+                .row => self.nextLiteralField(self.reader.seek, .row, true),
+                .quoted => if (has_quotes) self.nextQuotedChunk() else unreachable,
+            };
+            if (dialect.runtime) field.quote = self.settings.quote;
+            if (!field.partial) {
+                self.chunk = .none;
+                if (skips_lines) self.row_start = field.last_column;
+                if (tracks_position) {
+                    self.offset = self.base +% self.reader.seek;
+                    self.row += @intFromBool(field.last_column);
+                    self.column = if (field.last_column) 0 else self.column + 1;
+                }
+            }
+            return field;
+        }
+
+        /// Returns the position of the field the next call to `next()` returns, or of the field the last
+        /// call failed on (e.g. with `InvalidQuotes`). Requires `Dialect.track_position`.
+        ///
+        /// Rows skipped by `skipRowsWithout` are counted by their terminators, which overcounts rows with
+        /// terminators inside quoted fields.
+        pub fn position(self: *const Self) Position {
+            if (!tracks_position) @compileError("position() requires a dialect with track_position");
+            return .{ .offset = self.offset, .row = self.row, .column = self.column };
+        }
+
+        inline fn nextField(self: *Self, comptime chunked: bool) Error!Field {
             var r = self.reader;
+            var rescan: usize = 0;
             {
                 const seek = r.seek;
-                if (self.nextDelimPos(seek)) |end| {
+                if (self.nextBoundaryPos(seek, &rescan)) |end| {
                     @branchHint(.likely);
                     const delim = r.buffer[end];
-                    if (delim == dialect.quote) return self.nextQuotedRegion();
+                    if (has_quotes and delim == self.quoteChar()) return self.nextQuotedFieldTrimmed(seek, end, chunked);
 
                     return self.handleBoundary(delim, seek, end);
                 }
@@ -351,20 +1057,23 @@ pub fn Csv(comptime dialect: Dialect) type {
 
             while (true) {
                 const content_len = r.end - r.seek;
-                if (r.buffer.len - content_len == 0) break;
-                Reader.fillMore(r) catch |e| switch (e) {
+                if (r.buffer.len - content_len == 0 and !self.grow()) {
+                    if (chunked) return self.partialChunk(rescan, .unquoted);
+                    break;
+                }
+                self.fill() catch |e| switch (e) {
                     Reader.Error.EndOfStream => {
                         const remaining = r.buffered();
                         if (remaining.len == 0) return error.EOF;
                         r.toss(remaining.len);
-                        return .{ .data = remaining, .last_column = true };
+                        return .{ .data = trimmed(remaining, true), .last_column = true };
                     },
                     else => |err| return err,
                 };
                 const seek = r.seek;
-                if (self.nextDelimPos(seek + content_len)) |end| {
+                if (self.nextBoundaryPos(seek + content_len - rescan, &rescan)) |end| {
                     const delim = r.buffer[end];
-                    if (delim == dialect.quote) return self.nextQuotedRegion();
+                    if (has_quotes and delim == self.quoteChar()) return self.nextQuotedFieldTrimmed(seek, end, chunked);
 
                     return self.handleBoundary(delim, seek, end);
                 }
@@ -380,18 +1089,191 @@ pub fn Csv(comptime dialect: Dialect) type {
                     const remaining = r.buffer[r.seek..r.end];
                     if (remaining.len == 0) return error.EOF;
                     r.toss(remaining.len);
-                    return .{ .data = remaining, .last_column = true };
+                    return .{ .data = trimmed(remaining, true), .last_column = true };
                 },
             }
         }
 
+        /// skips the comment and empty lines at the start of a row, see `Dialect.comment`.
+        fn skipLines(self: *Self) error{ReadFailed}!void {
+            @branchHint(.unlikely);
+            const r = self.reader;
+            while (true) {
+                if (r.end - r.seek < @min(2, r.buffer.len)) {
+                    // the refill may move the bytes that pending scan positions point to.
+                    self.resetScan();
+                    self.fill() catch |err| switch (err) {
+                        error.EndOfStream => if (r.end == r.seek) return,
+                        else => |e| return e,
+                    };
+                }
+                const line = r.buffered();
+                if (dialect.comment != null and line[0] == dialect.comment.?) {
+                    var end = std.mem.indexOfScalar(u8, line, self.terminatorChar());
+                    // a comment longer than the buffer is dropped as it is read.
+                    while (end == null) {
+                        self.discard(r.end - r.seek);
+                        self.fill() catch |err| switch (err) {
+                            error.EndOfStream => return,
+                            else => |e| return e,
+                        };
+                        end = std.mem.indexOfScalar(u8, r.buffered(), self.terminatorChar());
+                    }
+                    self.discard(end.? + 1);
+                } else if (dialect.skip_empty_lines and line[0] == self.terminatorChar()) {
+                    self.discard(1);
+                } else if (dialect.skip_empty_lines and self.trimsCarriageReturn() and line.len > 1 and
+                    line[0] == CarriageReturn and line[1] == Newline)
+                {
+                    self.discard(2);
+                } else return;
+            }
+        }
+
+        /// Advances the iterator past the remaining fields of the current row.
+        ///
+        /// Use this once a row is known to be irrelevant (e.g. a filter predicate failed) to move on to
+        /// the next row without inspecting the remaining fields. Fields are never unescaped or copied.
+        /// If the previous field was the last column of its row, this skips the entire next row.
+        pub fn skipRow(self: *Self) Error!void {
+            while (!(try self.next()).last_column) {}
+        }
+
+        /// Skips complete rows whose raw bytes do not contain `needle`, stopping at the start of the first
+        /// row that might contain it or at the end of the input.
+        ///
+        /// This is a prefilter for highly selective searches. It runs a SIMD substring search over the
+        /// buffered bytes and only locates row boundaries around the hits, so rows without a hit are
+        /// discarded at memchr speed without ever being tokenized. A row boundary is a newline preceded by
+        /// an even number of quotes, which is exact for well formed CSV. The row it stops at still has to
+        /// be read with `next()` since the hit may be in the wrong column or span several fields.
+        ///
+        /// Must only be called at the start of a row.
+        pub fn skipRowsWithout(self: *Self, needle: []const u8) Error!void {
+            const r = self.reader;
+            while (true) {
+                const buffered = r.buffered();
+                if (simd.indexOfPos(buffered, 0, needle)) |hit| {
+                    if (self.lastRowBoundary(buffered[0..hit])) |boundary| self.discard(boundary + 1);
+                    return;
+                }
+
+                // keep the trailing partial row, the needle might continue after the refill.
+                if (self.lastRowBoundary(buffered)) |boundary| self.discard(boundary + 1);
+                if (r.end - r.seek == r.buffer.len) return; // a single row fills the buffer, let next() handle it.
+                // the refill may move the bytes that pending scan positions point to.
+                self.resetScan();
+                self.fill() catch |e| switch (e) {
+                    Reader.Error.EndOfStream => {
+                        // the last row has no line feed and no match either.
+                        self.discard(r.end - r.seek);
+                        return;
+                    },
+                    else => |err| return err,
+                };
+            }
+        }
+
+        /// returns the position of the last newline in `data` that is not inside a quoted region, assuming
+        /// `data` starts at a row boundary.
+        fn lastRowBoundary(self: *const Self, data: []const u8) ?usize {
+            if (!has_quotes or dialect.single_line_fields) return std.mem.lastIndexOfScalar(u8, data, self.terminatorChar());
+            // escaped quotes and quotes in comment lines do not toggle the quote state, so the rows are
+            // walked instead.
+            if (dialect.escape != null or dialect.comment != null) return self.rowWalker().lastRowEnd(data);
+            var end = data.len;
+            var quotes = simd.countScalar(data, self.quoteChar());
+            while (std.mem.lastIndexOfScalar(u8, data[0..end], self.terminatorChar())) |pos| {
+                quotes -= simd.countScalar(data[pos..end], self.quoteChar());
+                if (quotes % 2 == 0) return pos;
+                end = pos;
+            }
+            return null;
+        }
+
+        fn rowWalker(self: *const Self) parallel.RowWalker {
+            return .{
+                .quote = self.quoteChar(),
+                .escape = dialect.escape,
+                .comment = dialect.comment,
+                .terminator = self.terminatorChar(),
+            };
+        }
+
+        /// tosses `n` buffered bytes outside of `next()`, which invalidates any pending scan state.
+        inline fn discard(self: *Self, n: usize) void {
+            if (tracks_position) {
+                const r = self.reader;
+                self.row += simd.countScalar(r.buffer[r.seek..][0..n], self.terminatorChar());
+                self.offset = self.base +% (r.seek + n);
+            }
+            self.reader.toss(n);
+            self.resetScan();
+        }
+
+        /// refills the reader buffer, keeping `base` up to date if the buffered data is moved.
+        inline fn fill(self: *Self) Reader.Error!void {
+            if (self.growth) |*growth| self.shrink(growth);
+            if (!tracks_position) return Reader.fillMore(self.reader);
+            const offset = self.base +% self.reader.seek;
+            defer self.base = offset -% self.reader.seek;
+            return Reader.fillMore(self.reader);
+        }
+
         inline fn skipNextDelim(self: *Self) void {
             if (use_vectors) {
                 self.vector &= self.vector -% 1;
+            } else if (dialect.structural_index) {
+                if (self.index.head < self.index.len) self.index.head += 1;
+            }
+        }
+
+        /// drops the pending vector positions before `pos`.
+        inline fn skipUntil(self: *Self, pos: usize) void {
+            if (use_vectors) {
+                if (self.vector != 0) self.vector &= std.math.shl(Bitmask, ~@as(Bitmask, 0), pos - self.vector_offset);
+            } else if (dialect.structural_index) {
+                const index = &self.index;
+                while (index.head < index.len and index.start + index.positions[index.head] < pos) index.head += 1;
             }
         }
 
+        /// drops the pending vector positions, e.g. when the buffered data moves.
+        inline fn resetScan(self: *Self) void {
+            if (use_vectors) self.vector = 0;
+            if (dialect.structural_index) {
+                self.index.head = 0;
+                self.index.len = 0;
+            }
+        }
+
+        /// Same as `nextDelimPos` but skips first bytes of a multi-byte delimiter that are not followed by
+        /// the rest of it. A delimiter cut off by the end of the buffer is not returned, `rescan` is set to
+        /// the number of bytes the scan has to go back after a refill.
+        inline fn nextBoundaryPos(self: *Self, start_pos: usize, rescan: *usize) ?usize {
+            if (delimiter_tail.len == 0) return self.nextDelimPos(start_pos);
+            rescan.* = 0;
+            var i = start_pos;
+            while (self.nextDelimPos(i)) |idx| {
+                if (self.reader.buffer[idx] != Delimiter) return idx;
+                const complete = self.delimiterAt(idx) orelse {
+                    rescan.* = self.reader.end - idx;
+                    self.resetScan();
+                    return null;
+                };
+                if (complete) return idx;
+                i = idx + 1;
+            }
+            return null;
+        }
+
         inline fn nextDelimPos(self: *Self, start_pos: usize) ?usize {
+            if (dialect.structural_index) {
+                const index = &self.index;
+                if (index.head == index.len and !self.buildIndex(start_pos)) return null;
+                index.head += 1;
+                return index.start + index.positions[index.head - 1];
+            }
             const r = self.reader;
             if (use_vectors) {
                 if (self.vector != 0) {
@@ -403,14 +1285,10 @@ pub fn Csv(comptime dialect: Dialect) type {
 
             var i: usize = start_pos;
 
-            if (dialect.vector_length) |vector_len| {
-                while (i + vector_len < r.end) : (i += vector_len) {
-                    const input: Vector = r.buffer[i..r.end][0..vector_len].*;
-                    const q = input == QuoteMask;
-                    const comma = input == DelimiterMask;
-                    const newline = input == NewLineMask;
-                    const delim = (comma | q | newline);
-                    self.vector = @bitCast(delim);
+            if (use_vectors) {
+                const vector_len = scan_length;
+                while (i + vector_len <= r.end) : (i += vector_len) {
+                    self.vector = self.delimBits(r.buffer[i..r.end][0..vector_len].*);
                     if (self.vector != 0) {
                         const idx = @ctz(self.vector);
                         self.vector_offset = i;
@@ -418,20 +1296,122 @@ pub fn Csv(comptime dialect: Dialect) type {
                         return i + idx;
                     }
                 }
+                // the tail is classified with one more vector load that stays within the buffer (so the
+                // bytes around `i..end` are stale, not out of bounds) and masked to `i..end`. Its bits
+                // are handed out by later calls like any other vector, so a small buffer refilled often
+                // does not fall back to the scalar loop for every tail.
+                if (i < r.end and r.buffer.len >= vector_len) {
+                    const offset = @min(i, r.buffer.len - vector_len);
+                    const valid = std.math.shl(Bitmask, ~@as(Bitmask, 0), i - offset) &
+                        ~std.math.shl(Bitmask, ~@as(Bitmask, 0), r.end - offset);
+                    self.vector = self.delimBits(r.buffer[offset..][0..vector_len].*) & valid;
+                    if (self.vector == 0) return null;
+                    const idx = @ctz(self.vector);
+                    self.vector_offset = offset;
+                    self.vector &= self.vector - 1;
+                    return offset + idx;
+                }
             }
 
             while (i < r.end) : (i += 1) {
-                if (is_delim[r.buffer[i]]) return i;
+                const table = if (dialect.runtime) &self.settings.is_delim else &is_delim;
+                if (table[r.buffer[i]]) return i;
             }
 
             return null;
         }
+
+        /// stage one of a `structural_index` dialect: writes the positions of the quotes, delimiters and
+        /// terminators from `from` on into the index, until the end of the buffer or until the index is
+        /// full. Returns false if there are none up to the end of the buffer.
+        fn buildIndex(self: *Self, from: usize) bool {
+            const vector_len = scan_length;
+            const r = self.reader;
+            const index = &self.index;
+            // the masked tail load may start before `from`.
+            const start = if (r.buffer.len >= vector_len) @min(from, r.buffer.len - vector_len) else from;
+            // positions are stored as u32 offsets from `start`.
+            const end = @min(r.end, start + std.math.maxInt(u32));
+            var len: usize = 0;
+            var i = from;
+            while (i + vector_len <= end and len + vector_len <= structural_index_capacity) : (i += vector_len) {
+                len += self.indexBits(len, i - start, self.delimBits(r.buffer[i..][0..vector_len].*));
+            }
+            if (i + vector_len > end and i < end and len + vector_len <= structural_index_capacity) {
+                if (r.buffer.len >= vector_len) {
+                    // same masked tail load as `nextDelimPos`.
+                    const offset = @min(i, r.buffer.len - vector_len);
+                    const valid = std.math.shl(Bitmask, ~@as(Bitmask, 0), i - offset) &
+                        ~std.math.shl(Bitmask, ~@as(Bitmask, 0), end - offset);
+                    const bits = self.delimBits(r.buffer[offset..][0..vector_len].*) & valid;
+                    len += self.indexBits(len, offset - start, bits);
+                } else {
+                    const table = if (dialect.runtime) &self.settings.is_delim else &is_delim;
+                    for (r.buffer[i..end], i - start..) |byte, pos| {
+                        index.positions[len] = @intCast(pos);
+                        len += @intFromBool(table[byte]);
+                    }
+                }
+            }
+            index.start = start;
+            index.head = 0;
+            index.len = len;
+            return len > 0;
+        }
+
+        /// appends the positions of the bits set in `bits` (of a vector at `offset` from the index start) at
+        /// `len`, returns how many there are.
+        inline fn indexBits(self: *Self, len: usize, offset: usize, bits: Bitmask) usize {
+            const count = @popCount(bits);
+            const positions = self.index.positions[len..];
+            var remaining = bits;
+            var k: usize = 0;
+            // no branch per position: the writes past `count` are overwritten by the next vector.
+            while (k < count) : (k += index_unroll) {
+                inline for (0..index_unroll) |u| {
+                    positions[k + u] = @intCast(offset + @ctz(remaining));
+                    remaining &= remaining -% 1;
+                }
+            }
+            return count;
+        }
+
+        /// bitmask of the quotes, delimiters and terminators in `input`.
+        inline fn delimBits(self: *const Self, input: Vector) Bitmask {
+            if (use_swar) {
+                if (!has_quotes) return simd.swarMatch(input, .{ self.delimiterChar(), self.terminatorChar() });
+                return simd.swarMatch(input, .{ self.quoteChar(), self.delimiterChar(), self.terminatorChar() });
+            }
+            const comma = input == (if (dialect.runtime) self.settings.delimiter_mask else DelimiterMask);
+            const newline = input == (if (dialect.runtime) self.settings.terminator_mask else TerminatorMask);
+            if (!has_quotes) return @bitCast(comma | newline);
+            const q = input == (if (dialect.runtime) self.settings.quote_mask else QuoteMask);
+            return @bitCast(comma | q | newline);
+        }
     };
 }
 
+/// Same as `unescapeInPlace` for fields of a dialect with an `escape` character: every escape is dropped and
+/// the byte after it kept as is, doubled quotes are collapsed into one.
+pub fn unescapeEscapedInPlace(quote: u8, escape: u8, data: []u8) []u8 {
+    var read: usize = 0;
+    var write: usize = 0;
+    while (std.mem.indexOfAnyPos(u8, data, read, &.{ quote, escape })) |pos| {
+        @memmove(data[write..][0 .. pos - read], data[read..pos]);
+        write += pos - read;
+        // a lone quote (only in lenient recoveries) or a trailing escape are kept.
+        const pair = pos + 1 < data.len and (data[pos] == escape or data[pos + 1] == quote);
+        data[write] = data[pos + @intFromBool(pair)];
+        write += 1;
+        read = pos + 1 + @intFromBool(pair);
+    }
+    @memmove(data[write..][0 .. data.len - read], data[read..]);
+    return data[0 .. write + data.len - read];
+}
+
 /// Removes escape sequences from a string slice in-place by overwriting the data.
 /// Returns a smaller slice containing the unescaped string content.
-pub fn unescapeInPlace(comptime quote: u8, data: []u8) []u8 {
+pub fn unescapeInPlace(quote: u8, data: []u8) []u8 {
     var search_cursor: usize = 0;
     var write_cursor: usize = 0;
     var count: usize = 0;
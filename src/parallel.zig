@@ -0,0 +1,194 @@
+const std = @import("std");
+const simd = @import("simd.zig");
+const Allocator = std.mem.Allocator;
+
+/// Inputs smaller than this are scanned for quotes by the calling thread only.
+const parallel_scan_threshold = 1 << 20;
+
+/// Splits `data` into at most `count` chunks of roughly equal size that each start at a row boundary,
+/// so every chunk can be parsed by its own `Csv` iterator (e.g. on its own thread).
+///
+/// Returns the chunk boundaries: chunk `i` is `data[boundaries[i]..boundaries[i + 1]]`. The result has at
+/// least two entries (a single chunk covering everything) and must be freed with `allocator`.
+///
+/// Finding a row boundary from an arbitrary offset requires knowing whether the offset is inside a quoted
+/// region. The quotes of every segment are counted in parallel first (SIMD popcount), the parity of the
+/// quotes before a segment tells its initial quote state and the boundary is the first newline outside of
+/// quotes from there. This is exact for well formed CSV. Without a `quote` (see `Dialect.quote`, or for data
+/// whose quoted fields never span lines, see `Dialect.single_line_fields`) the boundary is simply the first
+/// newline after the segment start, found without counting anything.
+pub fn splitRows(allocator: Allocator, data: []const u8, count: usize, quote: ?u8) Allocator.Error![]usize {
+    return splitRowsWithTerminator(allocator, data, count, quote, '\n');
+}
+
+/// Same as `splitRows` for rows ending with `terminator` (see `Dialect.terminator`).
+pub fn splitRowsWithTerminator(
+    allocator: Allocator,
+    data: []const u8,
+    count: usize,
+    quote: ?u8,
+    terminator: u8,
+) Allocator.Error![]usize {
+    const n = @max(1, @min(count, data.len));
+    if (quote == null) return splitUnquoted(allocator, data, n, terminator);
+    const quotes = try allocator.alloc(usize, n);
+    defer allocator.free(quotes);
+
+    if (n > 1 and data.len >= parallel_scan_threshold) {
+        const threads = try allocator.alloc(?std.Thread, n);
+        defer allocator.free(threads);
+        for (threads[1..], 1..) |*thread, i| {
+            thread.* = std.Thread.spawn(.{}, countQuotes, .{ segment(data, n, i), quote.?, &quotes[i] }) catch null;
+            if (thread.* == null) countQuotes(segment(data, n, i), quote.?, &quotes[i]);
+        }
+        countQuotes(segment(data, n, 0), quote.?, &quotes[0]);
+        for (threads[1..]) |thread| if (thread) |t| t.join();
+    } else {
+        for (quotes, 0..) |*quote_count, i| countQuotes(segment(data, n, i), quote.?, quote_count);
+    }
+
+    var boundaries: std.ArrayList(usize) = try .initCapacity(allocator, n + 1);
+    errdefer boundaries.deinit(allocator);
+    boundaries.appendAssumeCapacity(0);
+
+    var quotes_before: usize = 0;
+    for (1..n) |i| {
+        quotes_before += quotes[i - 1];
+        const start = i * data.len / n;
+        // a long row may already span this segment start.
+        if (start <= boundaries.getLast()) continue;
+        const boundary = nextRowStart(data, start, quotes_before % 2 == 1, quote.?, terminator) orelse break;
+        if (boundary < data.len) boundaries.appendAssumeCapacity(boundary);
+    }
+
+    boundaries.appendAssumeCapacity(data.len);
+    return boundaries.toOwnedSlice(allocator);
+}
+
+/// every terminator is a row boundary when nothing is quoted, so each one is found directly.
+fn splitUnquoted(allocator: Allocator, data: []const u8, n: usize, terminator: u8) Allocator.Error![]usize {
+    var boundaries: std.ArrayList(usize) = try .initCapacity(allocator, n + 1);
+    errdefer boundaries.deinit(allocator);
+    boundaries.appendAssumeCapacity(0);
+
+    for (1..n) |i| {
+        const start = i * data.len / n;
+        if (start <= boundaries.getLast()) continue;
+        const newline = std.mem.indexOfScalarPos(u8, data, start, terminator) orelse break;
+        if (newline + 1 < data.len) boundaries.appendAssumeCapacity(newline + 1);
+    }
+
+    boundaries.appendAssumeCapacity(data.len);
+    return boundaries.toOwnedSlice(allocator);
+}
+
+/// Finds row boundaries of dialects where the quote parity alone does not tell whether a terminator ends a
+/// row, because quoted fields may contain escaped quotes (see `Dialect.escape`) or comment lines may contain
+/// unbalanced quotes (see `Dialect.comment`). Rows are walked forward from a known row start, jumping
+/// between quotes, escapes and terminators.
+pub const RowWalker = struct {
+    quote: u8,
+    escape: ?u8 = null,
+    comment: ?u8 = null,
+    terminator: u8 = '\n',
+
+    /// returns the position of the terminator ending the row (or comment line) that starts at `start`, or
+    /// null if it does not end within `data`.
+    pub fn rowEnd(self: RowWalker, data: []const u8, start: usize) ?usize {
+        if (self.comment) |comment| {
+            if (start < data.len and data[start] == comment) return std.mem.indexOfScalarPos(u8, data, start, self.terminator);
+        }
+        var i = start;
+        while (std.mem.indexOfAnyPos(u8, data, i, &[_]u8{ self.quote, self.terminator })) |pos| {
+            if (data[pos] == self.terminator) return pos;
+            i = pos + 1;
+            // skips the quoted region, the byte after an escape is data.
+            while (true) {
+                const at = (if (self.escape) |escape|
+                    std.mem.indexOfAnyPos(u8, data, i, &[_]u8{ self.quote, escape })
+                else
+                    std.mem.indexOfScalarPos(u8, data, i, self.quote)) orelse return null;
+                i = at + 1;
+                if (data[at] == self.quote) break;
+                i += 1;
+            }
+        }
+        return null;
+    }
+
+    /// returns the position of the last terminator in `data` that ends a row, assuming `data` starts at a
+    /// row boundary.
+    pub fn lastRowEnd(self: RowWalker, data: []const u8) ?usize {
+        var last: ?usize = null;
+        while (self.rowEnd(data, if (last) |end| end + 1 else 0)) |end| last = end;
+        return last;
+    }
+};
+
+/// Same as `splitRows` for rows found by `walker`. The rows are walked on the calling thread from the start
+/// of `data`, so the split costs one sequential pass over the input.
+pub fn splitRowsWalking(allocator: Allocator, data: []const u8, count: usize, walker: RowWalker) Allocator.Error![]usize {
+    const n = @max(1, @min(count, data.len));
+    var boundaries: std.ArrayList(usize) = try .initCapacity(allocator, n + 1);
+    errdefer boundaries.deinit(allocator);
+    boundaries.appendAssumeCapacity(0);
+
+    var row_start: usize = 0;
+    split: for (1..n) |i| {
+        const start = i * data.len / n;
+        while (row_start < start) row_start = (walker.rowEnd(data, row_start) orelse break :split) + 1;
+        if (row_start > boundaries.getLast() and row_start < data.len) boundaries.appendAssumeCapacity(row_start);
+    }
+
+    boundaries.appendAssumeCapacity(data.len);
+    return boundaries.toOwnedSlice(allocator);
+}
+
+fn segment(data: []const u8, n: usize, i: usize) []const u8 {
+    return data[i * data.len / n .. (i + 1) * data.len / n];
+}
+
+fn countQuotes(data: []const u8, quote: u8, result: *usize) void {
+    result.* = simd.countScalar(data, quote);
+}
+
+/// returns the position after the first terminator at or after `start` that is outside of quotes.
+fn nextRowStart(data: []const u8, start: usize, in_quotes: bool, quote: u8, terminator: u8) ?usize {
+    var quoted = in_quotes;
+    for (data[start..], start..) |byte, i| {
+        if (byte == quote) {
+            quoted = !quoted;
+        } else if (byte == terminator and !quoted) {
+            return i + 1;
+        }
+    }
+    return null;
+}
+
+/// A file mapped copy-on-write into memory, for parsing large files in parallel with `Reader.fixed`.
+///
+/// The mapping is private and writable so unescaping fields in place never touches the file.
+/// Only available on POSIX systems.
+pub const MappedFile = struct {
+    data: []u8,
+    mapping: ?[]align(std.heap.page_size_min) u8,
+
+    pub fn init(file: std.fs.File) !MappedFile {
+        const size = try file.getEndPos();
+        if (size == 0) return .{ .data = &.{}, .mapping = null };
+        const mapping = try std.posix.mmap(
+            null,
+            @intCast(size),
+            std.posix.PROT.READ | std.posix.PROT.WRITE,
+            .{ .TYPE = .PRIVATE },
+            file.handle,
+            0,
+        );
+        return .{ .data = mapping, .mapping = mapping };
+    }
+
+    pub fn deinit(self: *MappedFile) void {
+        if (self.mapping) |mapping| std.posix.munmap(mapping);
+        self.* = undefined;
+    }
+};
@@ -0,0 +1,431 @@
+const std = @import("std");
+const iterator = @import("iterator.zig");
+const parallel = @import("parallel.zig");
+const aggregate = @import("aggregate.zig");
+const schema = @import("schema.zig");
+const Writer = std.Io.Writer;
+const Allocator = std.mem.Allocator;
+
+/// HyperLogLog distinct count estimator with 2^12 one-byte registers (4 KiB, ~1.6% standard error).
+pub const HyperLogLog = struct {
+    registers: [register_count]u8 = @splat(0),
+
+    const precision = 12;
+    const register_count = 1 << precision;
+
+    pub fn add(self: *HyperLogLog, hash: u64) void {
+        const index = hash >> (64 - precision);
+        // the guard bit bounds the rank when the remaining bits are all zero.
+        const rest = (hash << precision) | (@as(u64, 1) << (precision - 1));
+        const rank: u8 = @intCast(@clz(rest) + 1);
+        self.registers[index] = @max(self.registers[index], rank);
+    }
+
+    pub fn merge(self: *HyperLogLog, other: *const HyperLogLog) void {
+        for (&self.registers, other.registers) |*register, rank| register.* = @max(register.*, rank);
+    }
+
+    pub fn estimate(self: *const HyperLogLog) f64 {
+        const m: f64 = register_count;
+        var sum: f64 = 0;
+        var zeros: usize = 0;
+        for (self.registers) |rank| {
+            sum += std.math.ldexp(@as(f64, 1), -@as(i32, rank));
+            zeros += @intFromBool(rank == 0);
+        }
+        const alpha = 0.7213 / (1.0 + 1.079 / m);
+        const raw = alpha * m * m / sum;
+        // linear counting is more accurate for small cardinalities.
+        if (raw <= 2.5 * m and zeros != 0) return m * @log(m / @as(f64, @floatFromInt(zeros)));
+        return raw;
+    }
+};
+
+/// Mergeable quantile sketch with a fixed memory footprint.
+///
+/// Values are kept in a stack of equally sized buffers where an item in level `l` stands for `2^l` values.
+/// When a level fills up it is sorted and every other item (starting at a random offset) is promoted to the
+/// next level. This is the Manku-Rajagopalan-Lindsay scheme that KLL refines; with `k = 128` the rank error
+/// stays around 1% and 32 levels cover 2^38 values.
+pub const QuantileSketch = struct {
+    levels: [max_levels][k]f64 = undefined,
+    lens: [max_levels]u8 = @splat(0),
+    count: u64 = 0,
+    coin: u64 = 0x9E3779B97F4A7C15,
+
+    const k = 128;
+    const max_levels = 32;
+
+    pub fn add(self: *QuantileSketch, value: f64) void {
+        self.count += 1;
+        self.insert(0, value);
+    }
+
+    pub fn merge(self: *QuantileSketch, other: *const QuantileSketch) void {
+        for (other.levels, other.lens, 0..) |items, len, level| {
+            for (items[0..len]) |value| self.insert(level, value);
+        }
+        self.count += other.count;
+    }
+
+    /// Writes the estimated value of every quantile in `fractions` (each in [0, 1]) to `out`.
+    pub fn quantiles(self: *const QuantileSketch, allocator: Allocator, fractions: []const f64, out: []f64) Allocator.Error!void {
+        const Item = struct {
+            value: f64,
+            weight: u64,
+
+            fn lessThan(_: void, a: @This(), b: @This()) bool {
+                return a.value < b.value;
+            }
+        };
+
+        var total: usize = 0;
+        for (self.lens) |len| total += len;
+        const items = try allocator.alloc(Item, total);
+        defer allocator.free(items);
+
+        var i: usize = 0;
+        var weight: u64 = 0;
+        for (self.levels, self.lens, 0..) |values, len, level| {
+            for (values[0..len]) |value| {
+                items[i] = .{ .value = value, .weight = @as(u64, 1) << @intCast(level) };
+                weight += items[i].weight;
+                i += 1;
+            }
+        }
+        std.mem.sort(Item, items, {}, Item.lessThan);
+
+        for (fractions, out) |fraction, *result| {
+            result.* = std.math.nan(f64);
+            const target = fraction * @as(f64, @floatFromInt(weight));
+            var cumulative: u64 = 0;
+            for (items) |item| {
+                cumulative += item.weight;
+                result.* = item.value;
+                if (@as(f64, @floatFromInt(cumulative)) >= target) break;
+            }
+        }
+    }
+
+    fn insert(self: *QuantileSketch, level: usize, value: f64) void {
+        const len = self.lens[level];
+        if (len == k) return; // only reachable at the top level, past 2^38 values.
+        self.levels[level][len] = value;
+        self.lens[level] = len + 1;
+        if (len + 1 == k and level + 1 < max_levels) self.compact(level);
+    }
+
+    fn compact(self: *QuantileSketch, level: usize) void {
+        const items = &self.levels[level];
+        std.mem.sort(f64, items, {}, std.sort.asc(f64));
+        self.lens[level] = 0;
+
+        // xorshift, one bit per compaction is all the randomness needed.
+        self.coin ^= self.coin << 13;
+        self.coin ^= self.coin >> 7;
+        self.coin ^= self.coin << 17;
+        var i: usize = @intCast(self.coin & 1);
+        while (i < k) : (i += 2) self.insert(level + 1, items[i]);
+    }
+};
+
+/// Statistics collected for a single column. Every sketch has a fixed size, so a column profile never
+/// grows with the input.
+pub const ColumnProfile = struct {
+    /// Header name, when the profiler was configured with a header row.
+    name: []const u8 = "",
+    /// Number of fields seen in this column.
+    count: u64 = 0,
+    /// Number of empty fields.
+    empty: u64 = 0,
+    min_length: usize = std.math.maxInt(usize),
+    max_length: usize = 0,
+    /// Number of fields of each `schema.Type`.
+    types: std.EnumArray(schema.Type, u64) = .initFill(0),
+    /// Smallest and largest numeric value.
+    min: f64 = std.math.inf(f64),
+    max: f64 = -std.math.inf(f64),
+    distinct: HyperLogLog = .{},
+    /// Distribution of the numeric values.
+    numbers: QuantileSketch = .{},
+
+    pub fn add(self: *ColumnProfile, value: []const u8) void {
+        self.count += 1;
+        self.min_length = @min(self.min_length, value.len);
+        self.max_length = @max(self.max_length, value.len);
+        self.distinct.add(std.hash.Wyhash.hash(0, value));
+
+        const value_type = schema.classify(value);
+        self.types.getPtr(value_type).* += 1;
+        switch (value_type) {
+            .empty => self.empty += 1,
+            .integer, .float => if (aggregate.parseNumber(value)) |number| {
+                self.min = @min(self.min, number);
+                self.max = @max(self.max, number);
+                self.numbers.add(number);
+            },
+            else => {},
+        }
+    }
+
+    /// Folds the statistics of `other` into this profile. The name is not merged, it is borrowed and
+    /// the owner of `self` must copy it, see `Profiler.merge`.
+    pub fn merge(self: *ColumnProfile, other: *const ColumnProfile) void {
+        self.count += other.count;
+        self.empty += other.empty;
+        self.min_length = @min(self.min_length, other.min_length);
+        self.max_length = @max(self.max_length, other.max_length);
+        for (&self.types.values, other.types.values) |*total, count| total.* += count;
+        self.min = @min(self.min, other.min);
+        self.max = @max(self.max, other.max);
+        self.distinct.merge(&other.distinct);
+        self.numbers.merge(&other.numbers);
+    }
+
+    /// The narrowest kind that can represent every non-empty field of the column.
+    pub fn inferredType(self: *const ColumnProfile) schema.Type {
+        var inferred: schema.Type = .empty;
+        for (std.enums.values(schema.Type)) |candidate| {
+            if (self.types.get(candidate) > 0) inferred = inferred.widen(candidate);
+        }
+        return inferred;
+    }
+};
+
+/// Configuration for a `Profiler`.
+pub const ProfileOptions = struct {
+    /// When true, the first row provides the column names and is not profiled.
+    header: bool = false,
+    /// Upper bound on the number of columns, each column takes roughly 40 KiB.
+    max_columns: usize = 4096,
+    /// Quantiles reported by `writeJson`.
+    quantiles: []const f64 = &.{ 0.01, 0.25, 0.5, 0.75, 0.99 },
+    /// Number of threads used by `profileParallel`, 0 uses one per CPU.
+    threads: usize = 0,
+};
+
+/// Creates a single-pass column profiler type for CSV data in the specified dialect.
+///
+/// Every column keeps a `ColumnProfile`: field count, empty rate, min/max length, inferred type, a
+/// HyperLogLog distinct count and a quantile sketch of the numeric values. Memory is fixed per column
+/// and profiles are mergeable, see `profileParallel`.
+///
+/// Example:
+/// ```zig
+/// var profiler = csvz.Profiler(.{}).init(allocator, .{ .header = true });
+/// defer profiler.deinit();
+/// try profiler.consume(&it);
+/// try profiler.writeJson(&stdout.interface);
+/// ```
+pub fn Profiler(comptime dialect: iterator.Dialect) type {
+    return struct {
+        allocator: Allocator,
+        options: Options,
+        columns: std.ArrayList(ColumnProfile) = .empty,
+        /// Rows profiled (excluding the header).
+        rows: u64 = 0,
+        /// Column names owned by the profiler.
+        names: std.ArrayList([]const u8) = .empty,
+
+        const Self = @This();
+        pub const Iterator = iterator.Csv(dialect);
+        pub const Options = ProfileOptions;
+        pub const Error = Iterator.Error || Allocator.Error || error{TooManyColumns};
+
+        pub fn init(allocator: Allocator, options: Options) Self {
+            return .{ .allocator = allocator, .options = options };
+        }
+
+        pub fn deinit(self: *Self) void {
+            for (self.names.items) |name| self.allocator.free(name);
+            self.names.deinit(self.allocator);
+            self.columns.deinit(self.allocator);
+        }
+
+        /// Profiles every remaining row of `it` until the end of the input.
+        pub fn consume(self: *Self, it: *Iterator) Error!void {
+            if (self.options.header) {
+                self.readHeader(it) catch |err| switch (err) {
+                    error.EOF => return,
+                    else => |e| return e,
+                };
+            }
+
+            var column: usize = 0;
+            while (true) {
+                var field = it.next() catch |err| switch (err) {
+                    error.EOF => return,
+                    else => |e| return e,
+                };
+                (try self.columnAt(column)).add(field.unescaped());
+                if (field.last_column) {
+                    self.rows += 1;
+                    column = 0;
+                } else column += 1;
+            }
+        }
+
+        /// Folds the profile of another part of the same input into this one. Column names are copied,
+        /// so `other` can be deinitialized afterwards.
+        pub fn merge(self: *Self, other: *const Self) Error!void {
+            for (other.columns.items, 0..) |*profile, column| {
+                const target = try self.columnAt(column);
+                if (target.name.len == 0 and profile.name.len > 0) {
+                    try self.names.ensureUnusedCapacity(self.allocator, 1);
+                    target.name = try self.allocator.dupe(u8, profile.name);
+                    self.names.appendAssumeCapacity(target.name);
+                }
+                target.merge(profile);
+            }
+            self.rows += other.rows;
+        }
+
+        /// Writes the profile as a JSON object with a `rows` count and one entry per column.
+        pub fn writeJson(self: *const Self, writer: *Writer) (Writer.Error || Allocator.Error)!void {
+            const values = try self.allocator.alloc(f64, self.options.quantiles.len);
+            defer self.allocator.free(values);
+
+            try writer.print("{{\"rows\":{d},\"columns\":[", .{self.rows});
+            for (self.columns.items, 0..) |*profile, column| {
+                if (column > 0) try writer.writeByte(',');
+                try writer.print("{{\"index\":{d},\"name\":", .{column});
+                try writeJsonString(writer, profile.name);
+                const non_empty = profile.count - profile.empty;
+                try writer.print(
+                    ",\"type\":\"{s}\",\"count\":{d},\"empty\":{d},\"empty_rate\":{d:.6},\"min_length\":{d},\"max_length\":{d},\"distinct\":{d:.0}",
+                    .{
+                        @tagName(profile.inferredType()),
+                        profile.count,
+                        profile.empty,
+                        @as(f64, @floatFromInt(profile.empty)) / @as(f64, @floatFromInt(@max(profile.count, 1))),
+                        if (profile.count == 0) 0 else profile.min_length,
+                        profile.max_length,
+                        if (non_empty == 0) 0 else profile.distinct.estimate(),
+                    },
+                );
+                if (profile.numbers.count > 0) {
+                    try writer.print(",\"min\":{d},\"max\":{d},\"quantiles\":{{", .{ profile.min, profile.max });
+                    try profile.numbers.quantiles(self.allocator, self.options.quantiles, values);
+                    for (self.options.quantiles, values, 0..) |fraction, value, i| {
+                        if (i > 0) try writer.writeByte(',');
+                        try writer.print("\"{d}\":{d}", .{ fraction, value });
+                    }
+                    try writer.writeByte('}');
+                }
+                try writer.writeByte('}');
+            }
+            try writer.writeAll("]}");
+        }
+
+        fn readHeader(self: *Self, it: *Iterator) Error!void {
+            var column: usize = 0;
+            while (true) : (column += 1) {
+                var field = try it.next();
+                const profile = try self.columnAt(column);
+                try self.names.ensureUnusedCapacity(self.allocator, 1);
+                profile.name = try self.allocator.dupe(u8, field.unescaped());
+                self.names.appendAssumeCapacity(profile.name);
+                if (field.last_column) return;
+            }
+        }
+
+        fn columnAt(self: *Self, column: usize) Error!*ColumnProfile {
+            if (column < self.columns.items.len) {
+                @branchHint(.likely);
+                return &self.columns.items[column];
+            }
+            if (column >= self.options.max_columns) return error.TooManyColumns;
+            try self.columns.appendNTimes(self.allocator, .{}, column + 1 - self.columns.items.len);
+            return &self.columns.items[column];
+        }
+    };
+}
+
+/// Profiles `data` on every core: the input is split at row boundaries, every chunk is profiled on its
+/// own thread and the profiles are merged. Fields are unescaped in place, so `data` is modified.
+/// `allocator` must be thread-safe.
+pub fn profileParallel(
+    comptime dialect: iterator.Dialect,
+    allocator: Allocator,
+    data: []u8,
+    options: ProfileOptions,
+) Profiler(dialect).Error!Profiler(dialect) {
+    const Worker = struct {
+        profiler: Profiler(dialect),
+        chunk: []u8,
+        result: Profiler(dialect).Error!void = {},
+
+        fn run(self: *@This()) void {
+            var reader = std.Io.Reader.fixed(self.chunk);
+            var it = Profiler(dialect).Iterator.init(&reader);
+            self.result = self.profiler.consume(&it);
+        }
+    };
+
+    const thread_count = if (options.threads != 0) options.threads else std.Thread.getCpuCount() catch 1;
+    // rows of a `single_line_fields` dialect end at every terminator, no quote has to be counted.
+    const row_quote = if (dialect.single_line_fields) null else dialect.quote;
+    // escaped quotes and comment lines break the quote parity, rows are walked instead.
+    const boundaries = if (row_quote != null and (dialect.escape != null or dialect.comment != null))
+        try parallel.splitRowsWalking(allocator, data, thread_count, .{
+            .quote = row_quote.?,
+            .escape = dialect.escape,
+            .comment = dialect.comment,
+            .terminator = dialect.terminator,
+        })
+    else
+        try parallel.splitRowsWithTerminator(allocator, data, thread_count, row_quote, dialect.terminator);
+    defer allocator.free(boundaries);
+
+    const workers = try allocator.alloc(Worker, boundaries.len - 1);
+    defer allocator.free(workers);
+    for (workers, 0..) |*worker, index| {
+        var worker_options = options;
+        worker_options.header = options.header and index == 0;
+        worker.* = .{
+            .profiler = .init(allocator, worker_options),
+            .chunk = data[boundaries[index]..boundaries[index + 1]],
+        };
+    }
+    // the first profiler is returned, every other one is merged into it.
+    defer for (workers[1..]) |*worker| worker.profiler.deinit();
+    errdefer workers[0].profiler.deinit();
+
+    const handles = try allocator.alloc(?std.Thread, workers.len);
+    defer allocator.free(handles);
+    for (workers[1..], handles[1..]) |*worker, *handle| {
+        handle.* = std.Thread.spawn(.{}, Worker.run, .{worker}) catch null;
+        if (handle.* == null) worker.run();
+    }
+    workers[0].run();
+    for (handles[1..]) |handle| if (handle) |h| h.join();
+
+    for (workers) |*worker| try worker.result;
+    for (workers[1..]) |*worker| try workers[0].profiler.merge(&worker.profiler);
+    return workers[0].profiler;
+}
+
+fn writeJsonString(writer: *Writer, value: []const u8) Writer.Error!void {
+    try writer.writeByte('"');
+    var start: usize = 0;
+    for (value, 0..) |byte, i| {
+        const escape: ?[]const u8 = switch (byte) {
+            '"' => "\\\"",
+            '\\' => "\\\\",
+            '\n' => "\\n",
+            '\r' => "\\r",
+            '\t' => "\\t",
+            else => null,
+        };
+        if (escape == null and byte >= 0x20) continue;
+        try writer.writeAll(value[start..i]);
+        if (escape) |sequence| {
+            try writer.writeAll(sequence);
+        } else {
+            try writer.print("\\u{x:0>4}", .{byte});
+        }
+        start = i + 1;
+    }
+    try writer.writeAll(value[start..]);
+    try writer.writeByte('"');
+}
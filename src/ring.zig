@@ -0,0 +1,111 @@
+const std = @import("std");
+const posix = std.posix;
+const Reader = std.Io.Reader;
+const Writer = std.Io.Writer;
+
+/// A file reader whose buffer is a window into a ring buffer mapped twice in a row (one memfd mapped at two
+/// consecutive addresses). When the reader runs out of space, the window moves forward to the unconsumed
+/// data instead of the data being copied to the front of the buffer, so a refill costs only the `read`
+/// however long the field spanning it is.
+///
+/// Linux only (`memfd_create`). The buffer length is rounded up to the page size. Like `std.fs.File.Reader`,
+/// the ring must not be moved once its `interface` is in use, and the file is not closed by `deinit`.
+///
+/// Example:
+/// ```zig
+/// var ring = try csvz.RingReader.init(file, 64 * 1024);
+/// defer ring.deinit();
+/// var it = csvz.Iterator.init(&ring.interface);
+/// ```
+pub const RingReader = struct {
+    interface: Reader,
+    file: std.fs.File,
+    /// both copies of the ring, twice the buffer length.
+    mapping: []align(std.heap.page_size_min) u8,
+    /// byte read ahead to tell a full writer apart from the end of the file, see `stream`.
+    lookahead: ?u8 = null,
+
+    pub const InitError = posix.MemFdCreateError || posix.TruncateError || posix.MMapError;
+
+    const vtable: Reader.VTable = .{
+        .stream = &stream,
+        .readVec = &readVec,
+        .rebase = &rebase,
+    };
+
+    pub fn init(file: std.fs.File, buffer_len: usize) InitError!RingReader {
+        const len = std.mem.alignForward(usize, @max(buffer_len, 1), std.heap.pageSize());
+        const fd = try posix.memfd_create("csvz-ring", 0);
+        defer posix.close(fd);
+        try posix.ftruncate(fd, len);
+
+        // reserve the address range first so the second copy lands right after the first one.
+        const mapping = try posix.mmap(null, 2 * len, posix.PROT.NONE, .{ .TYPE = .PRIVATE, .ANONYMOUS = true }, -1, 0);
+        errdefer posix.munmap(mapping);
+        for (0..2) |i| {
+            const copy: [*]align(std.heap.page_size_min) u8 = @alignCast(mapping[i * len ..].ptr);
+            _ = try posix.mmap(copy, len, posix.PROT.READ | posix.PROT.WRITE, .{ .TYPE = .SHARED, .FIXED = true }, fd, 0);
+        }
+        return .{
+            .interface = .{ .vtable = &vtable, .buffer = mapping[0..len], .seek = 0, .end = 0 },
+            .file = file,
+            .mapping = mapping,
+        };
+    }
+
+    pub fn deinit(self: *RingReader) void {
+        posix.munmap(self.mapping);
+        self.* = undefined;
+    }
+
+    /// reads into `dest`, fails with `EndOfStream` only if nothing is left.
+    fn read(self: *RingReader, dest: []u8) Reader.Error!usize {
+        if (dest.len == 0) return 0;
+        var n: usize = 0;
+        if (self.lookahead) |byte| {
+            dest[0] = byte;
+            self.lookahead = null;
+            n = 1;
+        }
+        n += self.file.read(dest[n..]) catch return error.ReadFailed;
+        return if (n == 0) error.EndOfStream else n;
+    }
+
+    fn stream(r: *Reader, w: *Writer, limit: std.Io.Limit) Reader.StreamError!usize {
+        const self: *RingReader = @alignCast(@fieldParentPtr("interface", r));
+        const dest = limit.slice(w.writableSliceGreedy(1) catch |err| {
+            // a full writer is only reported if there is more to read, `Csv` relies on this to tell
+            // `FieldTooLong` from the end of the input.
+            if (self.lookahead == null) {
+                var byte: [1]u8 = undefined;
+                _ = try self.read(&byte);
+                self.lookahead = byte[0];
+            }
+            return err;
+        });
+        const n = try self.read(dest);
+        w.advance(n);
+        return n;
+    }
+
+    fn readVec(r: *Reader, data: [][]u8) Reader.Error!usize {
+        _ = data;
+        const self: *RingReader = @alignCast(@fieldParentPtr("interface", r));
+        r.end += try self.read(r.buffer[r.end..]);
+        return 0;
+    }
+
+    fn rebase(r: *Reader, capacity: usize) Reader.RebaseError!void {
+        const self: *RingReader = @alignCast(@fieldParentPtr("interface", r));
+        const len = self.mapping.len / 2;
+        const start = @intFromPtr(r.buffer.ptr) -% @intFromPtr(self.mapping.ptr);
+        // the buffer was swapped by the user (e.g. `Csv.allowGrowth`), move the data as usual.
+        if (r.buffer.len != len or start >= len) return Reader.defaultRebase(r, capacity);
+
+        // the bytes after the end of the window are the ones before its start.
+        const window = (start + r.seek) % len;
+        r.buffer = self.mapping[window..][0..len];
+        r.end -= r.seek;
+        r.seek = 0;
+    }
+};
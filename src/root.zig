@@ -1,9 +1,61 @@
 const iterator = @import("iterator.zig");
 const emitter = @import("emitter.zig");
+const filter = @import("filter.zig");
+const aggregate = @import("aggregate.zig");
+const parallel = @import("parallel.zig");
+const profile = @import("profile.zig");
+const schema = @import("schema.zig");
+const sniff = @import("sniff.zig");
+const dynamic = @import("dynamic.zig");
 const simd = @import("simd.zig");
+const ring = @import("ring.zig");
+const tune = @import("tune.zig");
 
 pub const Csv = iterator.Csv;
+pub const Dialect = iterator.Dialect;
+pub const RuntimeDialect = iterator.RuntimeDialect;
+pub const Position = iterator.Position;
+pub const ParseError = iterator.ParseError;
+pub const ErrorLog = iterator.ErrorLog;
+pub const structural_index_capacity = iterator.structural_index_capacity;
+pub const unescapeInPlace = iterator.unescapeInPlace;
+pub const unescapeEscapedInPlace = iterator.unescapeEscapedInPlace;
 pub const Iterator = Csv(.{});
 pub const Emitter = emitter.Emitter;
+pub const Filter = filter.Filter;
+pub const Predicate = filter.Predicate;
+pub const Aggregator = aggregate.Aggregator;
+pub const Aggregate = aggregate.Aggregate;
+pub const AggregateOp = aggregate.Op;
+pub const AggregateTable = aggregate.Table;
+pub const Accumulator = aggregate.Accumulator;
+pub const aggregateParallel = aggregate.aggregateParallel;
+pub const PartitionedTable = aggregate.PartitionedTable;
+pub const splitRows = parallel.splitRows;
+pub const splitRowsWalking = parallel.splitRowsWalking;
+pub const RowWalker = parallel.RowWalker;
+pub const MappedFile = parallel.MappedFile;
+pub const RingReader = ring.RingReader;
+pub const Profiler = profile.Profiler;
+pub const ProfileOptions = profile.ProfileOptions;
+pub const ColumnProfile = profile.ColumnProfile;
+pub const profileParallel = profile.profileParallel;
+pub const ColumnType = schema.Type;
+pub const Schema = schema.Schema;
+pub const SchemaOptions = schema.SchemaOptions;
+pub const classify = schema.classify;
+pub const inferSchema = schema.inferSchema;
+pub const inferSchemaSampled = schema.inferSchemaSampled;
+pub const Sniffed = sniff.Sniffed;
+pub const sniffDialect = sniff.sniff;
+pub const sniffReader = sniff.sniffReader;
+pub const AnyIterator = dynamic.AnyIterator;
+pub const ByDialect = dynamic.ByDialect;
+pub const dialects = dynamic.dialects;
 
 pub const suggestVectorLength = simd.suggestVectorLength;
+pub const runtimeVectorLength = simd.runtimeVectorLength;
+pub const Tuning = tune.Tuning;
+pub const calibrate = tune.calibrate;
+pub const loadOrCalibrate = tune.loadOrCalibrate;
+pub const indexOfPos = simd.indexOfPos;
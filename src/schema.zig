@@ -0,0 +1,347 @@
+const std = @import("std");
+const iterator = @import("iterator.zig");
+const Allocator = std.mem.Allocator;
+
+/// Type of a single field or of a whole column.
+pub const Type = enum(c_int) {
+    empty,
+    boolean,
+    integer,
+    float,
+    date,
+    timestamp,
+    string,
+
+    /// Returns the most specific type that can represent values of both types.
+    pub fn widen(a: Type, b: Type) Type {
+        if (a == b or b == .empty) return a;
+        if (a == .empty) return b;
+        if ((a == .integer and b == .float) or (a == .float and b == .integer)) return .float;
+        if ((a == .date and b == .timestamp) or (a == .timestamp and b == .date)) return .timestamp;
+        return .string;
+    }
+};
+
+/// Fields up to this length are classified with vector masks, longer ones byte by byte.
+const block_len = 32;
+const Block = @Vector(block_len, u8);
+const Mask = std.meta.Int(.unsigned, block_len);
+
+/// digit positions of `YYYY-MM-DD`.
+const date_digits: Mask = 0b11_0110_1111;
+
+/// Classifies a single unescaped field.
+///
+/// Short fields are loaded into a vector and compared against digit, sign, dot and exponent classes at
+/// once. The resulting bitmasks settle integers directly and only hand candidates with the right shape to
+/// the float, date and timestamp grammars, so most fields never get trial-parsed.
+///
+/// Recognized forms are `true`/`false` (any case), integers with an optional sign, decimal floats with an
+/// optional exponent, `YYYY-MM-DD` dates and `YYYY-MM-DD[T ]HH:MM:SS[.f+][Z|+HH:MM]` timestamps.
+pub fn classify(bytes: []const u8) Type {
+    if (bytes.len == 0) return .empty;
+    if (bytes.len > block_len) return classifyScalar(bytes);
+
+    var padded: [block_len]u8 = @splat(0);
+    @memcpy(padded[0..bytes.len], bytes);
+    const block: Block = padded;
+    const valid: Mask = std.math.maxInt(Mask) >> @intCast(block_len - bytes.len);
+
+    const digits: Mask = @as(Mask, @bitCast(block -% splat('0') < splat(10))) & valid;
+    const signs: Mask = @bitCast((block == splat('-')) | (block == splat('+')));
+    const dots: Mask = @bitCast(block == splat('.'));
+    const exponents: Mask = @bitCast((block == splat('e')) | (block == splat('E')));
+
+    if (valid & ~(digits | signs | dots | exponents) == 0) {
+        if (digits == valid or (digits == valid & ~@as(Mask, 1) and signs & 1 != 0 and bytes.len > 1)) return .integer;
+        const number = numberType(bytes);
+        if (number != .string) return number;
+    }
+    if (digits & date_digits == date_digits) return dateTimeType(bytes);
+    return if (isBoolean(bytes)) .boolean else .string;
+}
+
+inline fn splat(byte: u8) Block {
+    return @splat(byte);
+}
+
+fn classifyScalar(bytes: []const u8) Type {
+    const number = numberType(bytes);
+    if (number != .string) return number;
+    return dateTimeType(bytes);
+}
+
+fn isBoolean(bytes: []const u8) bool {
+    return std.ascii.eqlIgnoreCase(bytes, "true") or std.ascii.eqlIgnoreCase(bytes, "false");
+}
+
+/// Returns `.integer`, `.float` or `.string` for `[sign] digits [. digits] [e [sign] digits]`.
+fn numberType(bytes: []const u8) Type {
+    var i: usize = @intFromBool(bytes[0] == '-' or bytes[0] == '+');
+    const digits_start = i;
+    while (i < bytes.len and std.ascii.isDigit(bytes[i])) i += 1;
+    var digits = i - digits_start;
+    if (i == bytes.len) return if (digits > 0) .integer else .string;
+
+    if (bytes[i] == '.') {
+        i += 1;
+        const fraction_start = i;
+        while (i < bytes.len and std.ascii.isDigit(bytes[i])) i += 1;
+        digits += i - fraction_start;
+    }
+    if (digits == 0) return .string;
+    if (i < bytes.len and (bytes[i] == 'e' or bytes[i] == 'E')) {
+        i += 1;
+        if (i < bytes.len and (bytes[i] == '-' or bytes[i] == '+')) i += 1;
+        const exponent_start = i;
+        while (i < bytes.len and std.ascii.isDigit(bytes[i])) i += 1;
+        if (i == exponent_start) return .string;
+    }
+    return if (i == bytes.len) .float else .string;
+}
+
+/// Returns `.date`, `.timestamp` or `.string`.
+fn dateTimeType(bytes: []const u8) Type {
+    if (bytes.len < 10 or bytes[4] != '-' or bytes[7] != '-') return .string;
+    const month = twoDigits(bytes[5..7]) orelse return .string;
+    const day = twoDigits(bytes[8..10]) orelse return .string;
+    if (!isDigits(bytes[0..4]) or month < 1 or month > 12 or day < 1 or day > 31) return .string;
+    if (bytes.len == 10) return .date;
+
+    if (bytes.len < 19 or (bytes[10] != 'T' and bytes[10] != ' ') or bytes[13] != ':' or bytes[16] != ':') return .string;
+    const hour = twoDigits(bytes[11..13]) orelse return .string;
+    const minute = twoDigits(bytes[14..16]) orelse return .string;
+    const second = twoDigits(bytes[17..19]) orelse return .string;
+    if (hour > 23 or minute > 59 or second > 60) return .string;
+
+    var rest = bytes[19..];
+    if (rest.len > 0 and rest[0] == '.') {
+        var i: usize = 1;
+        while (i < rest.len and std.ascii.isDigit(rest[i])) i += 1;
+        if (i == 1) return .string;
+        rest = rest[i..];
+    }
+    if (rest.len == 0 or std.mem.eql(u8, rest, "Z")) return .timestamp;
+    if (rest.len == 6 and (rest[0] == '+' or rest[0] == '-') and rest[3] == ':' and
+        twoDigits(rest[1..3]) != null and twoDigits(rest[4..6]) != null) return .timestamp;
+    return .string;
+}
+
+fn isDigits(bytes: []const u8) bool {
+    for (bytes) |byte| if (!std.ascii.isDigit(byte)) return false;
+    return true;
+}
+
+fn twoDigits(bytes: *const [2]u8) ?u8 {
+    if (!isDigits(bytes)) return null;
+    return (bytes[0] - '0') * 10 + (bytes[1] - '0');
+}
+
+/// Inferred type of a single column.
+pub const Column = struct {
+    /// Header name, or empty when the schema was inferred without a header row.
+    name: []const u8 = "",
+    /// Narrowest type that can represent every non-empty sampled field, `.empty` if all were empty.
+    type: Type = .empty,
+    /// Whether any sampled field was empty (or missing from a short row).
+    nullable: bool = false,
+};
+
+/// Result of schema inference, owns the column names.
+pub const Schema = struct {
+    allocator: Allocator,
+    columns: []Column,
+    /// Number of rows that were sampled (excluding the header).
+    rows: usize,
+
+    pub fn deinit(self: *Schema) void {
+        for (self.columns) |column| self.allocator.free(column.name);
+        self.allocator.free(self.columns);
+        self.* = undefined;
+    }
+};
+
+/// Configuration for `inferSchema` and `inferSchemaSampled`.
+pub const SchemaOptions = struct {
+    /// When true, the first row provides the column names and is not sampled.
+    header: bool = false,
+    /// Number of rows sampled from the start of the input.
+    sample_rows: usize = 1000,
+    /// Number of random positions sampled by `inferSchemaSampled`, on top of the first rows.
+    seeks: usize = 16,
+    /// Number of rows sampled at every random position.
+    rows_per_seek: usize = 16,
+    /// Row start offsets (e.g. from `splitRows` or an index built earlier). When set, random positions are
+    /// picked from it and are exact. Otherwise a position is moved to the next newline, which may be inside a
+    /// quoted field: samples that fail to parse or disagree on the column count are then discarded (except
+    /// for dialects without quotes or with `single_line_fields`, where every newline starts a row).
+    row_starts: ?[]const usize = null,
+    seed: u64 = 0,
+    max_columns: usize = 4096,
+};
+
+pub const SchemaError = Allocator.Error || error{TooManyColumns};
+
+/// Infers the column types from the first `options.sample_rows` rows of `it`.
+///
+/// Fields are classified on their raw bytes and never unescaped, so the iterator buffer is left untouched.
+pub fn inferSchema(
+    comptime dialect: iterator.Dialect,
+    allocator: Allocator,
+    it: *iterator.Csv(dialect),
+    options: SchemaOptions,
+) (iterator.Csv(dialect).Error || SchemaError)!Schema {
+    var builder: Builder = .{ .allocator = allocator, .max_columns = options.max_columns };
+    defer builder.deinit();
+    if (options.header) try builder.readHeader(dialect, it);
+    _ = try builder.sample(dialect, it, options.sample_rows);
+    return builder.finish();
+}
+
+/// Infers the column types of an in-memory input from its first rows and from `options.seeks` random
+/// positions, which catches columns whose type changes later in the file (e.g. ids that turn into strings).
+pub fn inferSchemaSampled(
+    comptime dialect: iterator.Dialect,
+    allocator: Allocator,
+    data: []const u8,
+    options: SchemaOptions,
+) (iterator.Csv(dialect).Error || SchemaError)!Schema {
+    var builder: Builder = .{ .allocator = allocator, .max_columns = options.max_columns };
+    defer builder.deinit();
+
+    var reader = std.Io.Reader.fixed(data);
+    var it = iterator.Csv(dialect).init(&reader);
+    if (options.header) try builder.readHeader(dialect, &it);
+    if (try builder.sample(dialect, &it, options.sample_rows) < options.sample_rows) return builder.finish();
+
+    const exact = options.row_starts != null or dialect.quote == null or dialect.single_line_fields;
+    var prng = std.Random.DefaultPrng.init(options.seed);
+    const random = prng.random();
+    var scratch: Builder = .{ .allocator = allocator, .max_columns = options.max_columns };
+    defer scratch.deinit();
+
+    for (0..options.seeks) |_| {
+        const start = if (options.row_starts) |row_starts| blk: {
+            if (row_starts.len == 0) break;
+            break :blk row_starts[random.uintLessThan(usize, row_starts.len)];
+        } else blk: {
+            const offset = random.uintLessThan(usize, data.len);
+            const newline = std.mem.indexOfScalarPos(u8, data, offset, dialect.terminator) orelse continue;
+            break :blk newline + 1;
+        };
+        if (start >= data.len) continue;
+
+        scratch.reset();
+        var seek_reader = std.Io.Reader.fixed(data[start..]);
+        var seek_it = iterator.Csv(dialect).init(&seek_reader);
+        _ = scratch.sample(dialect, &seek_it, options.rows_per_seek) catch |err| switch (err) {
+            error.OutOfMemory => |e| return e,
+            else => continue,
+        };
+        if (!exact and !scratch.consistent(builder.columns.items.len)) continue;
+        try builder.merge(&scratch);
+    }
+    return builder.finish();
+}
+
+const Builder = struct {
+    allocator: Allocator,
+    max_columns: usize,
+    columns: std.ArrayList(Column) = .empty,
+    rows: usize = 0,
+    /// every sampled row had exactly this many columns, or null if they differed.
+    width: ?usize = null,
+    mixed_widths: bool = false,
+
+    fn deinit(self: *Builder) void {
+        for (self.columns.items) |column| self.allocator.free(column.name);
+        self.columns.deinit(self.allocator);
+    }
+
+    fn reset(self: *Builder) void {
+        for (self.columns.items) |*column| column.* = .{ .name = column.name };
+        self.rows = 0;
+        self.width = null;
+        self.mixed_widths = false;
+    }
+
+    fn readHeader(self: *Builder, comptime dialect: iterator.Dialect, it: *iterator.Csv(dialect)) !void {
+        var column: usize = 0;
+        while (true) : (column += 1) {
+            const field = it.next() catch |err| switch (err) {
+                error.EOF => return,
+                else => |e| return e,
+            };
+            const quote = field.quoteChar();
+            const name = if (!field.needs_unescape)
+                try self.allocator.dupe(u8, field.data)
+            else if (dialect.escape) |escape| escaped: {
+                const copy = try self.allocator.dupe(u8, field.data);
+                const len = iterator.unescapeEscapedInPlace(quote, escape, copy).len;
+                break :escaped self.allocator.realloc(copy, len) catch |err| {
+                    self.allocator.free(copy);
+                    return err;
+                };
+            } else try std.mem.replaceOwned(u8, self.allocator, field.data, &.{ quote, quote }, &.{quote});
+            errdefer self.allocator.free(name);
+            (try self.columnAt(column)).name = name;
+            if (field.last_column) return;
+        }
+    }
+
+    /// Samples up to `limit` rows, returns the number of rows sampled.
+    fn sample(self: *Builder, comptime dialect: iterator.Dialect, it: *iterator.Csv(dialect), limit: usize) !usize {
+        var sampled: usize = 0;
+        var column: usize = 0;
+        while (sampled < limit) {
+            const field = it.next() catch |err| switch (err) {
+                error.EOF => break,
+                else => |e| return e,
+            };
+            const value_type: Type = if (field.needs_unescape) .string else classify(field.data);
+            const profile = try self.columnAt(column);
+            profile.type = profile.type.widen(value_type);
+            profile.nullable = profile.nullable or value_type == .empty;
+            if (!field.last_column) {
+                column += 1;
+                continue;
+            }
+
+            if (self.width) |width| {
+                self.mixed_widths = self.mixed_widths or width != column + 1;
+            } else self.width = column + 1;
+            // a short row leaves its missing columns empty.
+            for (self.columns.items[column + 1 ..]) |*missing| missing.nullable = true;
+            column = 0;
+            sampled += 1;
+        }
+        self.rows += sampled;
+        return sampled;
+    }
+
+    /// Returns true if every sampled row had `expected` columns.
+    fn consistent(self: *const Builder, expected: usize) bool {
+        return self.rows > 0 and !self.mixed_widths and self.width == expected;
+    }
+
+    fn merge(self: *Builder, other: *const Builder) !void {
+        for (other.columns.items, 0..) |from, column| {
+            const to = try self.columnAt(column);
+            to.type = to.type.widen(from.type);
+            to.nullable = to.nullable or from.nullable;
+        }
+        self.rows += other.rows;
+    }
+
+    fn columnAt(self: *Builder, column: usize) SchemaError!*Column {
+        if (column < self.columns.items.len) return &self.columns.items[column];
+        if (column >= self.max_columns) return error.TooManyColumns;
+        try self.columns.appendNTimes(self.allocator, .{}, column + 1 - self.columns.items.len);
+        return &self.columns.items[column];
+    }
+
+    fn finish(self: *Builder) Allocator.Error!Schema {
+        const columns = try self.columns.toOwnedSlice(self.allocator);
+        return .{ .allocator = self.allocator, .columns = columns, .rows = self.rows };
+    }
+};
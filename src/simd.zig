@@ -1,9 +1,15 @@
+const std = @import("std");
 const builtin = @import("builtin");
+const build_options = @import("build_options");
 
 /// suggests a good vector length for u8 types, which is used for the Csv iterators.
 /// For some of these CPUs, a value is chosen based on benchmarks, others based on the research on what is recommended
 /// for that CPU. For instance with AVX-2, 256-bit is recommended but using 64 bytes (512 bits) outperforms.
+/// The `-Dvector-length` build option overrides the choice (0 disables SIMD).
+///
+/// SVE and RISC-V V implementations choose their vector length, compare with `runtimeVectorLength()`.
 pub fn suggestVectorLength() ?comptime_int {
+    if (build_options.vector_length) |len| return if (len == 0) null else len;
     const cpu = builtin.cpu;
     if (cpu.arch.isX86()) {
         if (cpu.has(.x86, .avx512f) and !cpu.hasAny(.x86, &.{ .prefer_256_bit, .prefer_128_bit })) return 64;
@@ -50,3 +56,90 @@ pub fn suggestVectorLength() ?comptime_int {
     }
     return null;
 }
+
+/// Returns the vector length in bytes of the CPU running the program for architectures where it is only known at
+/// runtime: `cntb` with SVE and the `vlenb` register with RISC-V V. Returns `suggestVectorLength()` elsewhere.
+///
+/// The iterators use a fixed vector length (there is no length-agnostic scan), this tells whether the one they
+/// were built with matches the hardware (e.g. to pick `-Dvector-length` for a fleet of servers).
+pub fn runtimeVectorLength() ?usize {
+    const cpu = builtin.cpu;
+    if (cpu.arch.isAARCH64() and cpu.has(.aarch64, .sve)) {
+        return asm volatile ("cntb %[len]"
+            : [len] "=r" (-> usize),
+        );
+    }
+    if (cpu.arch.isRISCV() and cpu.has(.riscv, .v)) {
+        return asm volatile ("csrr %[len], vlenb"
+            : [len] "=r" (-> usize),
+        );
+    }
+    return suggestVectorLength();
+}
+
+/// Returns the index of the first occurrence of `needle` in `haystack` at or after `start`, or null.
+///
+/// Uses the SIMD "first and last byte" technique: every block compares the first byte of the needle against
+/// `haystack[i..]` and the last byte against `haystack[i + needle.len - 1..]`, and only candidates where both match
+/// are verified with a full comparison. This skips most of the haystack at memchr speed even for short needles.
+pub fn indexOfPos(haystack: []const u8, start: usize, needle: []const u8) ?usize {
+    if (needle.len == 0) return if (start <= haystack.len) start else null;
+    if (needle.len > haystack.len or start > haystack.len - needle.len) return null;
+    if (needle.len == 1) return std.mem.indexOfScalarPos(u8, haystack, start, needle[0]);
+
+    var i: usize = start;
+    if (suggestVectorLength()) |len| {
+        const Vec = @Vector(len, u8);
+        const Mask = std.meta.Int(.unsigned, len);
+        const first: Vec = @splat(needle[0]);
+        const last: Vec = @splat(needle[needle.len - 1]);
+        const tail = needle.len - 1;
+        while (i + tail + len <= haystack.len) : (i += len) {
+            const head_block: Vec = haystack[i..][0..len].*;
+            const tail_block: Vec = haystack[i + tail ..][0..len].*;
+            var candidates: Mask = @bitCast((head_block == first) & (tail_block == last));
+            while (candidates != 0) : (candidates &= candidates - 1) {
+                const pos = i + @ctz(candidates);
+                if (std.mem.eql(u8, haystack[pos + 1 .. pos + tail], needle[1..tail])) return pos;
+            }
+        }
+    }
+
+    return std.mem.indexOfPos(u8, haystack, i, needle);
+}
+
+/// Counts the occurrences of `value` in `haystack` using vector compares and popcount.
+pub fn countScalar(haystack: []const u8, value: u8) usize {
+    var count: usize = 0;
+    var i: usize = 0;
+    if (suggestVectorLength()) |len| {
+        const Vec = @Vector(len, u8);
+        const Mask = std.meta.Int(.unsigned, len);
+        const target: Vec = @splat(value);
+        while (i + len <= haystack.len) : (i += len) {
+            const block: Vec = haystack[i..][0..len].*;
+            const mask: Mask = @bitCast(block == target);
+            count += @popCount(mask);
+        }
+    }
+
+    for (haystack[i..]) |byte| count += @intFromBool(byte == value);
+    return count;
+}
+
+/// SWAR (SIMD within a register) classification for targets without SIMD: returns the bitmask of the bytes of
+/// `block` equal to one of `bytes` (a tuple of u8), from a single u64 load.
+pub inline fn swarMatch(block: [8]u8, bytes: anytype) u8 {
+    const ones: u64 = 0x0101010101010101;
+    const low7: u64 = 0x7F * ones;
+    const word = std.mem.readInt(u64, &block, .little);
+    var found: u64 = 0;
+    inline for (bytes) |byte| {
+        const x = word ^ (@as(u64, byte) *% ones);
+        // the high bit of a byte is set iff the byte is nonzero, adding the low bits never carries into the
+        // next byte so the result is exact.
+        found |= ~(((x & low7) +% low7) | x);
+    }
+    // gathers the high bit of byte k into bit k.
+    return @truncate((((found & ~low7) >> 7) *% 0x0102040810204080) >> 56);
+}
@@ -0,0 +1,252 @@
+const std = @import("std");
+const simd = @import("simd.zig");
+const schema = @import("schema.zig");
+const Reader = std.Io.Reader;
+
+/// Dialect and layout detected by `sniff`.
+pub const Sniffed = struct {
+    delimiter: u8 = ',',
+    quote: u8 = '"',
+    /// Rows end with `\r\n`.
+    crlf: bool = false,
+    /// The input starts with a UTF-8 byte order mark.
+    bom: bool = false,
+    /// The first row looks like a header: some column holds a string in the first row and only
+    /// numbers, booleans or dates below it.
+    header: bool = false,
+    /// Most common number of columns in the sampled rows.
+    columns: usize = 0,
+};
+
+/// Delimiters `sniff` chooses from.
+pub const delimiter_candidates = ",;\t|";
+/// Quote characters `sniff` chooses from.
+pub const quote_candidates = "\"'";
+/// Default number of bytes `sniffReader` looks at.
+pub const default_sample_len = 16 * 1024;
+
+const utf8_bom = "\xEF\xBB\xBF";
+/// Rows scored per candidate dialect.
+const max_rows = 256;
+/// Columns checked by the header detection.
+const max_header_columns = 64;
+
+/// Detects the dialect of a CSV sample.
+///
+/// Every candidate delimiter and quote that occurs in the sample (counted with SIMD byte histograms) is scored
+/// by how consistently it splits the sampled rows into the same number of fields. Candidates whose quoting
+/// would make the sample invalid are dropped. Among equally consistent candidates, a quote character that
+/// actually occurs wins, then the delimiter producing more columns. A sample that no candidate splits into
+/// several columns yields the default dialect.
+///
+/// `sample` is treated as complete, a trailing partial row should be trimmed by the caller (`sniffReader`
+/// does this).
+pub fn sniff(sample: []const u8) Sniffed {
+    var result: Sniffed = .{};
+    var data = sample;
+    if (std.mem.startsWith(u8, data, utf8_bom)) {
+        result.bom = true;
+        data = data[utf8_bom.len..];
+    }
+    if (std.mem.indexOfScalar(u8, data, '\n')) |newline| result.crlf = newline > 0 and data[newline - 1] == '\r';
+
+    var best: Score = .{};
+    for (quote_candidates) |quote| {
+        const has_quotes = simd.countScalar(data, quote) > 0;
+        // the first quote candidate is the default and is scored even when absent.
+        if (!has_quotes and quote != quote_candidates[0]) continue;
+        for (delimiter_candidates) |delimiter| {
+            if (simd.countScalar(data, delimiter) == 0) continue;
+            var score = (if (has_quotes)
+                scoreQuoted(data, delimiter, quote)
+            else
+                scoreLines(data, delimiter)) orelse continue;
+            score.quoted = has_quotes;
+            if (score.better(best)) {
+                best = score;
+                result.delimiter = delimiter;
+                result.quote = quote;
+            }
+        }
+    }
+    result.columns = if (best.columns > 0) best.columns else @intFromBool(data.len > 0);
+    result.header = detectHeader(data, result.delimiter, result.quote);
+    return result;
+}
+
+/// Sniffs the first `sample_len` bytes of `reader` (capped to its buffer size) without consuming them,
+/// except for a UTF-8 byte order mark which is discarded so the iterator never sees it.
+pub fn sniffReader(reader: *Reader, sample_len: usize) error{ReadFailed}!Sniffed {
+    const len = @min(sample_len, reader.buffer.len);
+    var complete = false;
+    var sample = reader.peek(len) catch |err| switch (err) {
+        error.EndOfStream => blk: {
+            complete = true;
+            break :blk reader.buffered();
+        },
+        error.ReadFailed => |e| return e,
+    };
+    if (!complete) {
+        if (std.mem.lastIndexOfScalar(u8, sample, '\n')) |newline| sample = sample[0 .. newline + 1];
+    }
+    const result = sniff(sample);
+    if (result.bom) reader.toss(utf8_bom.len);
+    return result;
+}
+
+const Score = struct {
+    /// fraction of rows with the most common width.
+    consistency: f64 = 0,
+    /// most common width.
+    columns: usize = 0,
+    /// the quote character occurs in the sample and quotes it validly.
+    quoted: bool = false,
+
+    fn better(self: Score, other: Score) bool {
+        if (self.columns < 2) return false;
+        if (self.consistency != other.consistency) return self.consistency > other.consistency;
+        if (self.quoted != other.quoted) return self.quoted;
+        return self.columns > other.columns;
+    }
+
+    fn of(widths: []u32) ?Score {
+        if (widths.len == 0) return null;
+        std.mem.sort(u32, widths, {}, std.sort.asc(u32));
+        var mode: u32 = widths[0];
+        var mode_count: usize = 0;
+        var run: usize = 0;
+        for (widths, 0..) |width, i| {
+            run = if (i > 0 and widths[i - 1] == width) run + 1 else 1;
+            if (run > mode_count) {
+                mode = width;
+                mode_count = run;
+            }
+        }
+        return .{
+            .consistency = @as(f64, @floatFromInt(mode_count)) / @as(f64, @floatFromInt(widths.len)),
+            .columns = mode,
+        };
+    }
+};
+
+/// Scores a delimiter for a sample without quotes, where every line is a row.
+fn scoreLines(data: []const u8, delimiter: u8) ?Score {
+    var widths: [max_rows]u32 = undefined;
+    var rows: usize = 0;
+    var lines = std.mem.splitScalar(u8, data, '\n');
+    while (lines.next()) |line| {
+        if (rows == max_rows) break;
+        if (line.len == 0 or (line.len == 1 and line[0] == '\r')) continue;
+        widths[rows] = @intCast(simd.countScalar(line, delimiter) + 1);
+        rows += 1;
+    }
+    return Score.of(widths[0..rows]);
+}
+
+/// Scores a delimiter and quote pair, returns null if the quoting is invalid for the sample.
+fn scoreQuoted(data: []const u8, delimiter: u8, quote: u8) ?Score {
+    var widths: [max_rows]u32 = undefined;
+    var rows: usize = 0;
+    var scanner: Scanner = .{ .data = data, .delimiter = delimiter, .quote = quote };
+    var width: u32 = 0;
+    while (rows < max_rows) {
+        const field = (scanner.next() catch return null) orelse break;
+        width += 1;
+        if (!field.last) continue;
+        // blank lines are not rows.
+        if (width > 1 or field.value.len > 0 or field.quoted) {
+            widths[rows] = width;
+            rows += 1;
+        }
+        width = 0;
+    }
+    return Score.of(widths[0..rows]);
+}
+
+fn detectHeader(data: []const u8, delimiter: u8, quote: u8) bool {
+    var first: [max_header_columns]schema.Type = @splat(.empty);
+    var rest: [max_header_columns]schema.Type = @splat(.empty);
+    var scanner: Scanner = .{ .data = data, .delimiter = delimiter, .quote = quote };
+    var row: usize = 0;
+    var column: usize = 0;
+    while (row < max_rows) {
+        const field = (scanner.next() catch return false) orelse break;
+        if (column < max_header_columns) {
+            const value_type: schema.Type = if (field.escaped) .string else schema.classify(field.value);
+            if (row == 0) first[column] = value_type else rest[column] = rest[column].widen(value_type);
+        }
+        if (field.last) {
+            row += 1;
+            column = 0;
+        } else column += 1;
+    }
+    if (row < 2) return false;
+    for (first, rest) |first_type, rest_type| {
+        if (first_type == .string and rest_type != .string and rest_type != .empty) return true;
+    }
+    return false;
+}
+
+/// Splits a sample into fields for a runtime delimiter and quote.
+const Scanner = struct {
+    data: []const u8,
+    delimiter: u8,
+    quote: u8,
+    pos: usize = 0,
+
+    const Field = struct {
+        /// field bytes without the surrounding quotes, escaped quotes are left as is.
+        value: []const u8,
+        quoted: bool = false,
+        escaped: bool = false,
+        last: bool,
+    };
+
+    /// Returns the next field, or null at the end of the data (or of the last complete quoted field).
+    fn next(self: *Scanner) error{InvalidQuotes}!?Field {
+        const data = self.data;
+        if (self.pos >= data.len) return null;
+
+        if (data[self.pos] == self.quote) {
+            const start = self.pos + 1;
+            var escaped = false;
+            var i = start;
+            while (true) {
+                const close = std.mem.indexOfScalarPos(u8, data, i, self.quote) orelse return null;
+                if (close + 1 < data.len and data[close + 1] == self.quote) {
+                    escaped = true;
+                    i = close + 2;
+                    continue;
+                }
+                return try self.finish(close + 1, .{ .value = data[start..close], .quoted = true, .escaped = escaped, .last = false });
+            }
+        }
+
+        const start = self.pos;
+        var i = start;
+        while (i < data.len and data[i] != self.delimiter and data[i] != '\n') : (i += 1) {
+            if (data[i] == self.quote) return error.InvalidQuotes;
+        }
+        var value = data[start..i];
+        if (i < data.len and value.len > 0 and value[value.len - 1] == '\r') value = value[0 .. value.len - 1];
+        return try self.finish(i, .{ .value = value, .last = false });
+    }
+
+    fn finish(self: *Scanner, end: usize, field: Field) error{InvalidQuotes}!Field {
+        var result = field;
+        var i = end;
+        if (i < self.data.len and self.data[i] == '\r' and field.quoted) i += 1;
+        if (i >= self.data.len) {
+            self.pos = self.data.len;
+            result.last = true;
+            return result;
+        }
+        if (self.data[i] == self.delimiter) {
+            self.pos = i + 1;
+        } else if (self.data[i] == '\n') {
+            self.pos = i + 1;
+            result.last = true;
+        } else return error.InvalidQuotes;
+        return result;
+    }
+};
@@ -351,3 +351,1042 @@ test "emitter" {
         }
     }
 }
+
+test "indexOfPos" {
+    const haystack = "the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy cat";
+    const needles = [_]string{ "t", "th", "fox", "lazy cat", "lazy dog", "cat", "jumps over the lazy cat", "zebra", "" };
+    for (needles) |needle| {
+        for ([_]usize{ 0, 1, 17, 45, haystack.len }) |start| {
+            const expected = std.mem.indexOfPos(u8, haystack, start, needle);
+            try std.testing.expectEqual(expected, csvz.indexOfPos(haystack, start, needle));
+        }
+    }
+    try std.testing.expectEqual(null, csvz.indexOfPos("ab", 0, "abc"));
+}
+
+test "runtimeVectorLength" {
+    const len = csvz.runtimeVectorLength() orelse return;
+    try std.testing.expect(len > 0 and std.math.isPowerOfTwo(len));
+}
+
+test "vector length build option" {
+    // CI runs the tests with -Dvector-length=0, 16 and 32, the default dialect has to scan with it.
+    const requested = @import("build_options").vector_length orelse return;
+    const actual: usize = csvz.Iterator.config.vector_length orelse 0;
+    try std.testing.expectEqual(requested, actual);
+}
+
+test "filter" {
+    const TestCase = struct {
+        name: string,
+        predicates: []const csvz.Predicate,
+        header: bool = true,
+        expectation: string,
+    };
+
+    const input =
+        \\id,status,message
+        \\1,200,"ok, fine"
+        \\2,504,gateway timeout
+        \\3,500,"internal ""error"""
+        \\4,404,not found
+        \\5
+    ;
+
+    const cases: []const TestCase = &.{
+        .{
+            .name = "no predicates",
+            .predicates = &.{},
+            .header = false,
+            .expectation = input,
+        },
+        .{
+            .name = "equals",
+            .predicates = &.{.{ .column = 1, .match = .{ .equals = "404" } }},
+            .expectation =
+            \\id,status,message
+            \\4,404,not found
+            ,
+        },
+        .{
+            .name = "prefix and contains",
+            .predicates = &.{
+                .{ .column = 1, .match = .{ .prefix = "50" } },
+                .{ .column = 2, .match = .{ .contains = "error" } },
+            },
+            .expectation =
+            \\id,status,message
+            \\3,500,"internal ""error"""
+            ,
+        },
+        .{
+            .name = "pattern",
+            .predicates = &.{.{ .column = 2, .match = .{ .pattern = "^.*t$" } }},
+            .expectation =
+            \\id,status,message
+            \\2,504,gateway timeout
+            ,
+        },
+        .{
+            .name = "range",
+            .predicates = &.{.{ .column = 1, .match = .{ .range = .{ .min = 300, .max = 599 } } }},
+            .header = false,
+            .expectation =
+            \\2,504,gateway timeout
+            \\3,500,"internal ""error"""
+            \\4,404,not found
+            ,
+        },
+        .{
+            .name = "missing column never matches",
+            .predicates = &.{.{ .column = 2, .match = .{ .contains = "o" } }},
+            .header = false,
+            .expectation =
+            \\1,200,"ok, fine"
+            \\2,504,gateway timeout
+            \\3,500,"internal ""error"""
+            \\4,404,not found
+            ,
+        },
+    };
+
+    for (cases) |tt| {
+        errdefer std.debug.print("\ntt: name={s}\n", .{tt.name});
+        const ally = std.testing.allocator;
+
+        const data = try ally.dupe(u8, input);
+        defer ally.free(data);
+        var reader = std.Io.Reader.fixed(data);
+        var it = csvz.Iterator.init(&reader);
+
+        var writer = std.Io.Writer.Allocating.init(ally);
+        defer writer.deinit();
+        var emitter = csvz.Emitter.init(&writer.writer);
+
+        var filter = csvz.Filter(.{}).init(ally, &it, tt.predicates, .{ .header = tt.header });
+        defer filter.deinit();
+        _ = try filter.run(&emitter);
+
+        try std.testing.expectEqualStrings(tt.expectation, writer.written());
+    }
+}
+
+test "filter prefilter" {
+    const input =
+        \\key,note
+        \\a,"needle in the
+        \\wrong column"
+        \\needle,"multi
+        \\line"
+        \\b,"no match, ""quoted"""
+        \\needle,last
+    ;
+    const expectation =
+        \\key,note
+        \\needle,"multi
+        \\line"
+        \\needle,last
+    ;
+
+    for ([_]bool{ true, false }) |prefilter| {
+        errdefer std.debug.print("\nprefilter={}\n", .{prefilter});
+        const ally = std.testing.allocator;
+
+        const data = try ally.dupe(u8, input);
+        defer ally.free(data);
+        var reader = std.Io.Reader.fixed(data);
+        var it = csvz.Iterator.init(&reader);
+
+        var writer = std.Io.Writer.Allocating.init(ally);
+        defer writer.deinit();
+        var emitter = csvz.Emitter.init(&writer.writer);
+
+        var filter = csvz.Filter(.{}).init(ally, &it, &.{
+            .{ .column = 0, .match = .{ .equals = "needle" } },
+        }, .{ .header = true, .prefilter = prefilter });
+        defer filter.deinit();
+        const stats = try filter.run(&emitter);
+
+        try std.testing.expectEqualStrings(expectation, writer.written());
+        try std.testing.expectEqual(2, stats.matched);
+    }
+}
+
+test "filter prefilter escape" {
+    const ally = std.testing.allocator;
+    // the raw field holds two backslashes, the unescaped one a single one.
+    const data = try ally.dupe(u8, "x,\"no\"\ny,\"a\\\\b\"\n");
+    defer ally.free(data);
+    var reader = std.Io.Reader.fixed(data);
+    var it = csvz.Csv(.{ .escape = '\\' }).init(&reader);
+
+    var writer = std.Io.Writer.Allocating.init(ally);
+    defer writer.deinit();
+    var emitter = csvz.Emitter.init(&writer.writer);
+    var filter = csvz.Filter(.{ .escape = '\\' }).init(ally, &it, &.{
+        .{ .column = 1, .match = .{ .contains = "a\\b" } },
+    }, .{ .prefilter = true });
+    defer filter.deinit();
+    // a literal with an escape byte may not appear in the raw bytes, it is not used as the needle.
+    try std.testing.expect(filter.needle == null);
+    const stats = try filter.run(&emitter);
+
+    try std.testing.expectEqualStrings("y,a\\b", writer.written());
+    try std.testing.expectEqual(1, stats.matched);
+}
+
+test "filter prefilter refills" {
+    const ally = std.testing.allocator;
+    var input: std.Io.Writer.Allocating = .init(ally);
+    defer input.deinit();
+    var expected: std.Io.Writer.Allocating = .init(ally);
+    defer expected.deinit();
+    for (0..40) |i| {
+        const key = if (i % 7 == 3) "needle" else "hay";
+        try input.writer.print("{s},\"row {d:0>2} with a note, long enough to span refills\"\n", .{ key, i });
+        if (i % 7 == 3) try expected.writer.print("needle,\"row {d:0>2} with a note, long enough to span refills\"\n", .{i});
+    }
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.writeFile(.{ .sub_path = "data.csv", .data = input.written() });
+    // the buffer never holds more than two rows, so the prefilter refills with scan positions pending.
+    for (64..129) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        const file = try tmp.dir.openFile("data.csv", .{});
+        defer file.close();
+        const buffer = try ally.alloc(u8, buffer_size);
+        defer ally.free(buffer);
+        var reader = file.reader(buffer);
+        var it = csvz.Iterator.init(&reader.interface);
+
+        var writer = std.Io.Writer.Allocating.init(ally);
+        defer writer.deinit();
+        var emitter = csvz.Emitter.init(&writer.writer);
+        var filter = csvz.Filter(.{}).init(ally, &it, &.{
+            .{ .column = 0, .match = .{ .equals = "needle" } },
+        }, .{ .prefilter = true });
+        defer filter.deinit();
+        const stats = try filter.run(&emitter);
+
+        // the emitter separates rows, the last one has no terminator.
+        try std.testing.expectEqualStrings(expected.written()[0 .. expected.written().len - 1], writer.written());
+        try std.testing.expectEqual(6, stats.matched);
+    }
+}
+
+test "aggregator" {
+    const ally = std.testing.allocator;
+    const data = try ally.dupe(u8,
+        \\id,city,amount,note
+        \\1,Berlin,10,a
+        \\2,Paris,2.5,b
+        \\3,Berlin,-4,c
+        \\4,"Paris",,d
+        \\5,Rome,abc,e
+        \\6
+        \\7,Berlin,30,f
+    );
+    defer ally.free(data);
+    var reader = std.Io.Reader.fixed(data);
+    var it = csvz.Iterator.init(&reader);
+
+    var aggregator = try csvz.Aggregator(.{}).init(ally, .{
+        .key_column = 1,
+        .aggregates = &.{
+            .{ .column = 0, .op = .count },
+            .{ .column = 2, .op = .sum },
+            .{ .column = 2, .op = .min },
+            .{ .column = 2, .op = .max },
+        },
+        .header = true,
+    });
+    defer aggregator.deinit();
+    try aggregator.consume(&it);
+
+    const Expected = struct { key: string, count: u64, sum: f64, min: f64, max: f64 };
+    const expected = [_]Expected{
+        .{ .key = "Berlin", .count = 3, .sum = 36, .min = -4, .max = 30 },
+        .{ .key = "Paris", .count = 2, .sum = 2.5, .min = 2.5, .max = 2.5 },
+        .{ .key = "Rome", .count = 1, .sum = 0, .min = std.math.inf(f64), .max = -std.math.inf(f64) },
+    };
+
+    const table = &aggregator.table;
+    try std.testing.expectEqual(expected.len, table.len());
+    try std.testing.expectEqual(6, aggregator.rows);
+    try std.testing.expectEqual(1, aggregator.skipped);
+    for (expected, 0..) |group, index| {
+        try std.testing.expectEqualStrings(group.key, table.key(index));
+        const values = table.accumulatorsOf(index);
+        try std.testing.expectEqual(group.count, values[0].count);
+        try std.testing.expectEqual(group.sum, values[1].number);
+        try std.testing.expectEqual(group.min, values[2].number);
+        try std.testing.expectEqual(group.max, values[3].number);
+    }
+
+    // merging a table into an empty one keeps every group intact.
+    var merged = csvz.AggregateTable.init(ally, table.ops, 16);
+    defer merged.deinit();
+    try merged.merge(table);
+    try merged.merge(table);
+    try std.testing.expectEqual(table.len(), merged.len());
+    try std.testing.expectEqual(6, merged.accumulatorsOf(0)[0].count);
+    try std.testing.expectEqual(72, merged.accumulatorsOf(0)[1].number);
+
+    var limited = csvz.AggregateTable.init(ally, table.ops, 2);
+    defer limited.deinit();
+    try std.testing.expectError(error.TooManyGroups, limited.merge(table));
+}
+
+test "splitRows" {
+    const data = "a,b\n\"x\ny\",1\n\"\"\"\n\",2\nc,d\ne,f\n";
+    for (1..data.len + 2) |count| {
+        const boundaries = try csvz.splitRows(std.testing.allocator, data, count, '"');
+        defer std.testing.allocator.free(boundaries);
+        try std.testing.expectEqual(0, boundaries[0]);
+        try std.testing.expectEqual(data.len, boundaries[boundaries.len - 1]);
+        for (boundaries[1 .. boundaries.len - 1]) |boundary| {
+            // every boundary must be one of the real row starts.
+            try std.testing.expect(std.mem.indexOfScalar(usize, &.{ 4, 12, 20, 24 }, boundary) != null);
+        }
+    }
+
+    // without quotes every newline ends a row.
+    const unquoted = "a\"b\n\"c\n\"\"\nd\n";
+    for (1..unquoted.len + 2) |count| {
+        const boundaries = try csvz.splitRows(std.testing.allocator, unquoted, count, null);
+        defer std.testing.allocator.free(boundaries);
+        try std.testing.expectEqual(unquoted.len, boundaries[boundaries.len - 1]);
+        for (boundaries[1 .. boundaries.len - 1]) |boundary| {
+            try std.testing.expect(std.mem.indexOfScalar(usize, &.{ 4, 7, 10 }, boundary) != null);
+        }
+    }
+}
+
+test "aggregateParallel" {
+    const ally = std.testing.allocator;
+    var input: std.Io.Writer.Allocating = .init(ally);
+    defer input.deinit();
+    try input.writer.writeAll("key,value\n");
+    for (0..2000) |i| try input.writer.print("\"k{d}\",{d}\n", .{ i % 37, i });
+    // a newline inside quotes must never be taken as a chunk boundary.
+    try input.writer.writeAll("\"k\n0\",1\n");
+
+    var tmp = std.testing.tmpDir(.{ .iterate = true });
+    defer tmp.cleanup();
+
+    for ([_]usize{ 1 << 30, 4096 }) |budget| {
+        errdefer std.debug.print("\nbudget={d}\n", .{budget});
+        const data = try ally.dupe(u8, input.written());
+        defer ally.free(data);
+
+        var result = try csvz.aggregateParallel(.{}, ally, data, .{
+            .key_column = 0,
+            .aggregates = &.{ .{ .column = 0, .op = .count }, .{ .column = 1, .op = .sum } },
+            .header = true,
+            .threads = 4,
+            .memory_budget = budget,
+            .partition_bits = 3,
+            .spill_dir = tmp.dir,
+        });
+        defer result.deinit();
+
+        try std.testing.expectEqual(38, result.len());
+        try std.testing.expectEqual(2001, result.rows);
+        var count: u64 = 0;
+        var sum: f64 = 0;
+        for (result.partitions) |*table| {
+            for (0..table.len()) |group| {
+                const values = table.accumulatorsOf(group);
+                count += values[0].count;
+                sum += values[1].number;
+            }
+        }
+        try std.testing.expectEqual(2001, count);
+        try std.testing.expectEqual(1999 * 2000 / 2 + 1, sum);
+    }
+
+    // spill files are removed once the result is built.
+    var leftovers = tmp.dir.iterate();
+    try std.testing.expectEqual(null, try leftovers.next());
+}
+
+test "profiler" {
+    const ally = std.testing.allocator;
+    var input: std.Io.Writer.Allocating = .init(ally);
+    defer input.deinit();
+    try input.writer.writeAll("id,name,score,flag\n");
+    for (0..1000) |i| {
+        if (i % 4 == 0) {
+            try input.writer.print("{d},\"n{d}\",,{s}\n", .{ i, i % 10, if (i % 2 == 0) "true" else "false" });
+        } else {
+            try input.writer.print("{d},\"n{d}\",{d}.5,{s}\n", .{ i, i % 10, i, if (i % 2 == 0) "true" else "false" });
+        }
+    }
+
+    for ([_]usize{ 1, 4 }) |threads| {
+        errdefer std.debug.print("\nthreads={d}\n", .{threads});
+        const data = try ally.dupe(u8, input.written());
+        defer ally.free(data);
+        var profiler = try csvz.profileParallel(.{}, ally, data, .{ .header = true, .threads = threads });
+        defer profiler.deinit();
+
+        try std.testing.expectEqual(1000, profiler.rows);
+        const columns = profiler.columns.items;
+        try std.testing.expectEqual(4, columns.len);
+        try std.testing.expectEqualStrings("name", columns[1].name);
+        try std.testing.expectEqual(csvz.ColumnType.integer, columns[0].inferredType());
+        try std.testing.expectEqual(csvz.ColumnType.string, columns[1].inferredType());
+        try std.testing.expectEqual(csvz.ColumnType.float, columns[2].inferredType());
+        try std.testing.expectEqual(csvz.ColumnType.boolean, columns[3].inferredType());
+        try std.testing.expectEqual(250, columns[2].empty);
+        try std.testing.expectEqual(0, columns[2].min_length);
+        try std.testing.expectEqual(5, columns[2].max_length);
+        try std.testing.expectEqual(1.5, columns[2].min);
+        try std.testing.expectEqual(999.5, columns[2].max);
+        try std.testing.expectApproxEqAbs(10, columns[1].distinct.estimate(), 1);
+        try std.testing.expectApproxEqRel(1000, columns[0].distinct.estimate(), 0.05);
+
+        var median: [1]f64 = undefined;
+        try columns[0].numbers.quantiles(ally, &.{0.5}, &median);
+        try std.testing.expectApproxEqAbs(500, median[0], 30);
+
+        var json: std.Io.Writer.Allocating = .init(ally);
+        defer json.deinit();
+        try profiler.writeJson(&json.writer);
+        try std.testing.expect(std.mem.startsWith(u8, json.written(), "{\"rows\":1000,\"columns\":[{\"index\":0,\"name\":\"id\",\"type\":\"integer\""));
+        const parsed = try std.json.parseFromSlice(std.json.Value, ally, json.written(), .{});
+        defer parsed.deinit();
+    }
+
+    // merged column names are owned by the destination.
+    var merged = csvz.Profiler(.{}).init(ally, .{});
+    defer merged.deinit();
+    {
+        var reader = std.Io.Reader.fixed("a,b\n1,2\n");
+        var it = csvz.Profiler(.{}).Iterator.init(&reader);
+        var source = csvz.Profiler(.{}).init(ally, .{ .header = true });
+        defer source.deinit();
+        try source.consume(&it);
+        try merged.merge(&source);
+    }
+    try std.testing.expectEqualStrings("b", merged.columns.items[1].name);
+    try std.testing.expectEqual(1, merged.rows);
+}
+
+test "classify" {
+    const cases = [_]struct { string, csvz.ColumnType }{
+        .{ "", .empty },
+        .{ "42", .integer },
+        .{ "-7", .integer },
+        .{ "-", .string },
+        .{ "123456789012345678901234567890123456", .integer },
+        .{ "3.14", .float },
+        .{ "-1e10", .float },
+        .{ ".5", .float },
+        .{ "1.5E-3", .float },
+        .{ "1e", .string },
+        .{ "1-2", .string },
+        .{ "TRUE", .boolean },
+        .{ "false", .boolean },
+        .{ "2024-02-29", .date },
+        .{ "2024-13-01", .string },
+        .{ "2024-02-29T12:30:00", .timestamp },
+        .{ "2024-02-29 12:30:00.123Z", .timestamp },
+        .{ "2024-02-29T12:30:00.123456789+05:30", .timestamp },
+        .{ "2024-02-29T25:00:00", .string },
+        .{ "nan", .string },
+        .{ "hello", .string },
+    };
+    for (cases) |case| {
+        errdefer std.debug.print("\nvalue={s}\n", .{case[0]});
+        try std.testing.expectEqual(case[1], csvz.classify(case[0]));
+    }
+}
+
+test "inferSchema" {
+    const ally = std.testing.allocator;
+    var input: std.Io.Writer.Allocating = .init(ally);
+    defer input.deinit();
+    try input.writer.writeAll("id,\"the \"\"name\"\"\",price,day,note\n");
+    var row_starts: std.ArrayList(usize) = .empty;
+    defer row_starts.deinit(ally);
+    for (0..2000) |i| {
+        try row_starts.append(ally, input.written().len);
+        try input.writer.print("{d},n{d},{d},2024-01-{d:0>2},", .{ i, i, i, i % 28 + 1 });
+        // the last column only turns into a string deep into the input.
+        if (i == 1500) {
+            try input.writer.writeAll("\"multi\nline\"\n");
+        } else if (i > 1500) {
+            try input.writer.print("x{d}\n", .{i});
+        } else try input.writer.print("{d}\n", .{i});
+    }
+    const data = input.written();
+
+    var reader = std.Io.Reader.fixed(data);
+    var it = csvz.Iterator.init(&reader);
+    var head = try csvz.inferSchema(.{}, ally, &it, .{ .header = true, .sample_rows = 100 });
+    defer head.deinit();
+    try std.testing.expectEqual(100, head.rows);
+    try std.testing.expectEqual(5, head.columns.len);
+    try std.testing.expectEqualStrings("the \"name\"", head.columns[1].name);
+    const expected = [_]csvz.ColumnType{ .integer, .string, .integer, .date, .integer };
+    for (head.columns, expected) |column, column_type| try std.testing.expectEqual(column_type, column.type);
+
+    // with and without a row index to seek to.
+    for ([_]?[]const usize{ row_starts.items, null }) |starts| {
+        var sampled = try csvz.inferSchemaSampled(.{}, ally, data, .{
+            .header = true,
+            .sample_rows = 100,
+            .seeks = 64,
+            .row_starts = starts,
+        });
+        defer sampled.deinit();
+        try std.testing.expectEqual(5, sampled.columns.len);
+        try std.testing.expectEqual(csvz.ColumnType.integer, sampled.columns[0].type);
+        try std.testing.expectEqual(csvz.ColumnType.date, sampled.columns[3].type);
+        try std.testing.expectEqual(csvz.ColumnType.string, sampled.columns[4].type);
+        try std.testing.expect(!sampled.columns[4].nullable);
+    }
+}
+
+test "sniff" {
+    const cases = [_]struct { string, csvz.Sniffed }{
+        .{ "a,b,c\n1,2,3\n4,5,6\n", .{ .delimiter = ',', .header = true, .columns = 3 } },
+        .{ "name;price\r\n\"x;y\";1.5\r\nz;2.5\r\n", .{ .delimiter = ';', .crlf = true, .header = true, .columns = 2 } },
+        .{ "\xEF\xBB\xBFa\tb\nc\td\n", .{ .delimiter = '\t', .bom = true, .columns = 2 } },
+        .{ "id|note\n1|it's\n2|'a|b'\n", .{ .delimiter = '|', .header = true, .columns = 2 } },
+        .{ "'a,b',c\n'd,e',f\n", .{ .delimiter = ',', .quote = '\'', .columns = 2 } },
+        .{ "single\ncolumn\n", .{ .columns = 1 } },
+    };
+    for (cases) |case| {
+        errdefer std.debug.print("\ninput={s}\n", .{case[0]});
+        try std.testing.expectEqual(case[1], csvz.sniffDialect(case[0]));
+    }
+}
+
+test "AnyIterator" {
+    var reader = std.Io.Reader.fixed("\xEF\xBB\xBFid;name\n1;'a;''b'''\n2;c\n");
+    var sniffed: csvz.Sniffed = undefined;
+    var it = try csvz.AnyIterator.initSniffed(&reader, &sniffed);
+    try std.testing.expectEqual(';', sniffed.delimiter);
+    try std.testing.expectEqual('\'', sniffed.quote);
+    try std.testing.expect(sniffed.bom);
+    try std.testing.expect(sniffed.header);
+    try it.skipRow();
+
+    const expected = [_]string{ "1", "a;'b'", "2", "c" };
+    for (expected, 0..) |value, i| {
+        var field = try it.next();
+        try std.testing.expectEqualStrings(value, field.unescaped());
+        try std.testing.expectEqual(i % 2 == 1, field.last_column);
+    }
+    try std.testing.expectError(error.EOF, it.next());
+
+    var reader2 = std.Io.Reader.fixed("a:'b:c'\n");
+    var it2 = try csvz.AnyIterator.select(&reader2, .{ .delimiter = ':', .quote = '\'' });
+    try std.testing.expect(it2.inner == .runtime);
+    try std.testing.expectEqualStrings("a", (try it2.next()).data);
+    try std.testing.expectEqualStrings("b:c", (try it2.next()).data);
+    try std.testing.expectError(error.EOF, it2.next());
+    try std.testing.expect((try csvz.AnyIterator.select(&reader2, .{ .delimiter = '\t' })).inner == .tab);
+    try std.testing.expectError(error.InvalidDialect, csvz.AnyIterator.select(&reader2, .{ .delimiter = '"' }));
+}
+
+test "runtime dialect" {
+    const Runtime = csvz.Csv(.{ .runtime = true });
+    const data = "a:'b:''c'''\r\n'x\r\ny':z\r\n";
+    {
+        var reader = std.Io.Reader.fixed(data);
+        var it = try Runtime.initDialect(&reader, .{ .delimiter = ':', .quote = '\'' });
+        const expected = [_]string{ "a", "b:'c'", "x\r\ny", "z" };
+        for (expected, 0..) |value, i| {
+            var field = try it.next();
+            try std.testing.expectEqualStrings(value, field.unescaped());
+            try std.testing.expectEqual(i % 2 == 1, field.last_column);
+        }
+        try std.testing.expectError(error.EOF, it.next());
+    }
+    {
+        // the carriage return is kept in unquoted fields and is invalid after a closing quote.
+        var reader = std.Io.Reader.fixed("a:b\r\n'c'\r\n");
+        var it = try Runtime.initDialect(&reader, .{ .delimiter = ':', .quote = '\'', .trim_cr = false });
+        try std.testing.expectEqualStrings("a", (try it.next()).data);
+        try std.testing.expectEqualStrings("b\r", (try it.next()).data);
+        try std.testing.expectError(error.InvalidQuotes, it.next());
+    }
+    var reader = std.Io.Reader.fixed(data);
+    try std.testing.expectError(error.InvalidDialect, Runtime.initDialect(&reader, .{ .delimiter = ':', .quote = ':' }));
+    try std.testing.expectError(error.InvalidDialect, Runtime.initDialect(&reader, .{ .delimiter = '\n' }));
+}
+
+/// parses `data` from a file read through a `buffer_size` buffer and joins the fields with ',' and '\n'.
+fn joinFields(comptime dialect: csvz.Dialect, dir: std.fs.Dir, data: string, buffer_size: usize) ![]u8 {
+    try dir.writeFile(.{ .sub_path = "data.csv", .data = data });
+    const file = try dir.openFile("data.csv", .{});
+    defer file.close();
+    const buffer = try std.testing.allocator.alloc(u8, buffer_size);
+    defer std.testing.allocator.free(buffer);
+    var reader = file.reader(buffer);
+    var it = csvz.Csv(dialect).init(&reader.interface);
+
+    var out: std.Io.Writer.Allocating = .init(std.testing.allocator);
+    defer out.deinit();
+    while (true) {
+        var field = it.next() catch |err| switch (err) {
+            error.EOF => break,
+            else => |e| return e,
+        };
+        try out.writer.writeAll(field.unescaped());
+        try out.writer.writeByte(if (field.last_column) '\n' else ',');
+    }
+    return out.toOwnedSlice();
+}
+
+test "terminator and delimiter sequence" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    // every buffer size moves the refills, and with them cut off delimiters and quotes, around.
+    for (10..40) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        {
+            const joined = try joinFields(.{ .terminator = 0x1E, .delimiter_sequence = "||" }, tmp.dir, "a||b|c\x1E\"x||y\"||\"q\"\"\"\x1E||z|\x1E\"w\"", buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("a,b|c\nx||y,q\"\n,z|\nw\n", joined);
+        }
+        {
+            const joined = try joinFields(.{ .terminator = '\r' }, tmp.dir, "a,b\r\"c\r\n\",d\r\ne\r\"f\"\r", buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("a,b\nc\r\n,d\n\ne\nf\n", joined);
+        }
+        {
+            // a '\r' right after a closing quote at the end of the buffer.
+            const joined = try joinFields(.{}, tmp.dir, "\"abc\"\r\n\"defgh\"\r\n\"ij\",k\r\n", buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("abc\ndefgh\nij,k\n", joined);
+        }
+    }
+
+    var reader = std.Io.Reader.fixed("a\x1Eb");
+    try std.testing.expectError(error.InvalidDialect, csvz.Csv(.{ .runtime = true }).initDialect(&reader, .{ .terminator = ',' }));
+    var it = try csvz.Csv(.{ .runtime = true }).initDialect(&reader, .{ .terminator = 0x1E });
+    try std.testing.expect((try it.next()).last_column);
+    try std.testing.expectEqualStrings("b", (try it.next()).data);
+}
+
+test "quote-free dialect" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const data = "a\t\"b\r\n\"c\"\"\t\"\r\n" ** 4 ++ "x\t\"y";
+    const expected = "a,\"b\n\"c\"\",\"\n" ** 4 ++ "x,\"y\n";
+    for (8..40) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for (.{ null, 16 }) |vector_length| {
+            const joined = try joinFields(.{ .delimiter = '\t', .quote = null, .vector_length = vector_length }, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings(expected, joined);
+        }
+    }
+
+    // a runtime dialect without quote gets its own iterator, the quote nullness has to match.
+    var reader = std.Io.Reader.fixed("\"a\t\"\"b\"\n");
+    var it = try csvz.AnyIterator.select(&reader, .{ .delimiter = '\t', .quote = null });
+    try std.testing.expect(it.inner == .runtime_unquoted);
+    try std.testing.expectEqualStrings("\"a", (try it.next()).data);
+    try std.testing.expectEqualStrings("\"\"b\"", (try it.next()).data);
+    try std.testing.expectError(error.EOF, it.next());
+    try std.testing.expectError(error.InvalidDialect, csvz.Csv(.{ .runtime = true }).initDialect(&reader, .{ .quote = null }));
+    try std.testing.expectError(error.InvalidDialect, csvz.Csv(.{ .runtime = true, .quote = null }).initDialect(&reader, .{}));
+}
+
+test "vector tail" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const data = "a,bb,\"c\"\"c\"\r\n" ** 6 ++ "dddddddd,e\r\n\"f,\r\n\",g";
+    const expected = "a,bb,c\"c\n" ** 6 ++ "dddddddd,e\nf,\r\n,g\n";
+
+    // the tail of the buffer is scanned with a masked vector unless the buffer is smaller than a vector.
+    // Without SIMD, the same happens with 8 byte SWAR words.
+    const dialects = [_]csvz.Dialect{
+        .{ .vector_length = 16 },
+        .{ .vector_length = 32 },
+        .{ .vector_length = 16, .runtime = true },
+        .{ .vector_length = null },
+        .{ .vector_length = null, .runtime = true },
+        .{ .vector_length = null, .delimiter_sequence = "," },
+    };
+    for (10..70) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for (dialects) |dialect| {
+            const joined = try joinFields(dialect, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings(expected, joined);
+        }
+    }
+}
+
+test "structural index" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const data = "a,bb,\"c\"\"c\"\r\n" ** 6 ++ "dddddddd,e\r\n\"f,\r\n\",g";
+    const expected = "a,bb,c\"c\n" ** 6 ++ "dddddddd,e\nf,\r\n,g\n";
+    const dialects = [_]csvz.Dialect{
+        .{ .structural_index = true, .vector_length = 16 },
+        .{ .structural_index = true, .vector_length = 32, .runtime = true },
+        .{ .structural_index = true, .vector_length = 16, .lenient = true },
+        .{ .structural_index = true, .vector_length = 16, .delimiter_sequence = "||" },
+    };
+
+    for (10..70) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for (dialects[0..3]) |dialect| {
+            const joined = try joinFields(dialect, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings(expected, joined);
+        }
+        const joined = try joinFields(dialects[3], tmp.dir, "a||b|c\n\"x||y\"||z\n", buffer_size);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("a,b|c\nx||y,z\n", joined);
+    }
+
+    // more positions than fit in the index in one scan.
+    const narrow = "1,2,3,4,5,6,7,8\n" ** 300;
+    const joined = try joinFields(dialects[0], tmp.dir, narrow, 8192);
+    defer std.testing.allocator.free(joined);
+    try std.testing.expectEqualStrings(narrow, joined);
+}
+
+test "lenient" {
+    const data = "a,b\"c,d\n\"x\"y,z\n\"ok\",1\n\"unclosed,2\n3,4";
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    for (16..48) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        const joined = try joinFields(.{ .lenient = true }, tmp.dir, data, buffer_size);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("a,b\"c,d\nx\"y,z\nok,1\nunclosed,2\n3,4\n", joined);
+    }
+
+    const Counter = struct {
+        fn count(context: ?*anyopaque, _: csvz.ParseError) void {
+            const calls: *usize = @ptrCast(@alignCast(context.?));
+            calls.* += 1;
+        }
+    };
+    var calls: usize = 0;
+    var reader = std.Io.Reader.fixed(data);
+    var it = csvz.Csv(.{ .lenient = true }).init(&reader);
+    it.errors.callback = &Counter.count;
+    it.errors.context = &calls;
+    while (true) _ = it.next() catch |err| switch (err) {
+        error.EOF => break,
+        else => |e| return e,
+    };
+    try std.testing.expectEqual(3, it.errors.count);
+    try std.testing.expectEqual(3, calls);
+    try std.testing.expectEqual(csvz.ParseError{ .kind = .bare_quote, .offset = 3, .row = 0, .column = 1 }, it.errors.latest(2).?);
+    try std.testing.expectEqual(csvz.ParseError{ .kind = .invalid_quotes, .offset = 8, .row = 1, .column = 0 }, it.errors.latest(1).?);
+    try std.testing.expectEqual(csvz.ParseError{ .kind = .invalid_quotes, .offset = 22, .row = 3, .column = 0 }, it.errors.latest(0).?);
+    try std.testing.expectEqual(null, it.errors.latest(3));
+
+    // the rest of a recovered row that does not fit the buffer is skipped.
+    for (16..32) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        const joined = try joinFields(.{ .lenient = true }, tmp.dir, "1,\"" ++ "y" ** 64 ++ "\n2,3\n", buffer_size);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("1,\n2,3\n", joined);
+    }
+}
+
+test "single line fields" {
+    const data = "x,\"a\nb,c\n\"d,e\",\"f\"\"\"\r\n";
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    for (12..40) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        // an unclosed quote only takes the rest of its own line.
+        const joined = try joinFields(.{ .single_line_fields = true, .lenient = true }, tmp.dir, data, buffer_size);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("x,a\nb,c\nd,e,f\"\n", joined);
+    }
+
+    var reader = std.Io.Reader.fixed(data);
+    var it = csvz.Csv(.{ .single_line_fields = true }).init(&reader);
+    try std.testing.expectEqualStrings("x", (try it.next()).data);
+    try std.testing.expectError(error.InvalidQuotes, it.next());
+
+    var lenient_reader = std.Io.Reader.fixed(data);
+    var lenient = csvz.Csv(.{ .single_line_fields = true, .lenient = true }).init(&lenient_reader);
+    while (true) _ = lenient.next() catch |err| switch (err) {
+        error.EOF => break,
+        else => |e| return e,
+    };
+    try std.testing.expectEqual(csvz.ParseError{ .kind = .invalid_quotes, .offset = 2, .row = 0, .column = 1 }, lenient.errors.latest(0).?);
+    try std.testing.expectEqual(1, lenient.errors.count);
+}
+
+test "escape" {
+    const data =
+        \\a,"b\"c",d
+        \\"e\\","x\ny"
+        \\"g\\\"h""i",j
+        \\
+    ;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    for (16..48) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for (.{ null, 16 }) |vector_length| {
+            const joined = try joinFields(.{ .escape = '\\', .vector_length = vector_length }, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("a,b\"c,d\ne\\,xny\ng\\\"h\"i,j\n", joined);
+        }
+    }
+
+    // a closing quote can not be escaped.
+    var reader = std.Io.Reader.fixed("\"a\\\"");
+    var it = csvz.Csv(.{ .escape = '\\' }).init(&reader);
+    try std.testing.expectError(error.InvalidQuotes, it.next());
+
+    var field = "x\\\\\"\"y\\".*;
+    try std.testing.expectEqualStrings("x\\\"y\\", csvz.unescapeEscapedInPlace('"', '\\', &field));
+
+    // row boundaries skip escaped quotes: the first row spans two lines.
+    const rows = "\"a\\\"b\nc\",1\nx,2\n";
+    const walker: csvz.RowWalker = .{ .quote = '"', .escape = '\\' };
+    try std.testing.expectEqual(10, walker.rowEnd(rows, 0));
+    try std.testing.expectEqual(14, walker.lastRowEnd(rows));
+    const boundaries = try csvz.splitRowsWalking(std.testing.allocator, rows, 3, walker);
+    defer std.testing.allocator.free(boundaries);
+    try std.testing.expectEqualSlices(usize, &.{ 0, 11, 15 }, boundaries);
+
+    var rows_reader = std.Io.Reader.fixed(rows);
+    var rows_it = csvz.Csv(.{ .escape = '\\' }).init(&rows_reader);
+    try rows_it.skipRowsWithout("x");
+    try std.testing.expectEqualStrings("x", (try rows_it.next()).data);
+}
+
+test "comment and empty lines" {
+    const data = "#meta,x\n\na,#b\r\n\r\n# \"c\n#\n\"d\ne\",f\n\n#" ++ "z" ** 50 ++ "\ng,h";
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    for (8..40) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        const joined = try joinFields(.{ .comment = '#', .skip_empty_lines = true }, tmp.dir, data, buffer_size);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("a,#b\nd\ne,f\ng,h\n", joined);
+    }
+    {
+        // without skip_empty_lines an empty line is a row with one empty field.
+        const joined = try joinFields(.{ .comment = '#' }, tmp.dir, "#x\n\na\n", 16);
+        defer std.testing.allocator.free(joined);
+        try std.testing.expectEqualStrings("\na\n", joined);
+    }
+
+    // skipped lines still count as rows.
+    var reader = std.Io.Reader.fixed("#x\n\ny\n");
+    var it = csvz.Csv(.{ .comment = '#', .skip_empty_lines = true, .track_position = true }).init(&reader);
+    try std.testing.expectEqualStrings("y", (try it.next()).data);
+    try std.testing.expectEqual(csvz.Position{ .offset = 6, .row = 3, .column = 0 }, it.position());
+    try std.testing.expectError(error.EOF, it.next());
+
+    // the quote of a comment line does not open a quoted region.
+    const rows = "# \"c\nx,1\ny,2\n";
+    const walker: csvz.RowWalker = .{ .quote = '"', .comment = '#' };
+    try std.testing.expectEqual(4, walker.rowEnd(rows, 0));
+    const boundaries = try csvz.splitRowsWalking(std.testing.allocator, rows, 2, walker);
+    defer std.testing.allocator.free(boundaries);
+    try std.testing.expectEqualSlices(usize, &.{ 0, 9, 13 }, boundaries);
+
+    var rows_reader = std.Io.Reader.fixed(rows);
+    var rows_it = csvz.Csv(.{ .comment = '#' }).init(&rows_reader);
+    try rows_it.skipRowsWithout("y");
+    try std.testing.expectEqualStrings("y", (try rows_it.next()).data);
+}
+
+test "position" {
+    var reader = std.Io.Reader.fixed("a,\"b\nc\"\r\nd,e\nf,\"g\"x\n");
+    var it = csvz.Csv(.{ .track_position = true }).init(&reader);
+    const expected = [_]csvz.Position{
+        .{ .offset = 0, .row = 0, .column = 0 },
+        .{ .offset = 2, .row = 0, .column = 1 },
+        .{ .offset = 9, .row = 1, .column = 0 },
+        .{ .offset = 11, .row = 1, .column = 1 },
+        .{ .offset = 13, .row = 2, .column = 0 },
+    };
+    for (expected) |position| {
+        try std.testing.expectEqual(position, it.position());
+        _ = try it.next();
+    }
+    // a failing field keeps its position.
+    try std.testing.expectEqual(csvz.Position{ .offset = 15, .row = 2, .column = 1 }, it.position());
+    try std.testing.expectError(error.InvalidQuotes, it.next());
+    try std.testing.expectEqual(csvz.Position{ .offset = 15, .row = 2, .column = 1 }, it.position());
+
+    var reader2 = std.Io.Reader.fixed("a,b\nc,d\n");
+    var tracked = try csvz.AnyIterator.selectTracked(&reader2, .{});
+    try tracked.skipRow();
+    try std.testing.expectEqual(csvz.Position{ .offset = 4, .row = 1, .column = 0 }, tracked.position().?);
+    var untracked = csvz.AnyIterator.init(.{}, &reader2);
+    try std.testing.expectEqual(null, untracked.position());
+}
+
+test "growable buffer" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const long = "x" ** 300;
+    try tmp.dir.writeFile(.{ .sub_path = "data.csv", .data = "a,b\n\"" ++ long ++ "\",c\nd,e\n" });
+
+    for ([_]usize{ 1024, 128 }) |max_len| {
+        const file = try tmp.dir.openFile("data.csv", .{});
+        defer file.close();
+        var buffer: [32]u8 = undefined;
+        var reader = file.reader(&buffer);
+        var it = csvz.Iterator.init(&reader.interface);
+        it.allowGrowth(std.testing.allocator, max_len);
+        defer it.deinit();
+
+        for ([_]string{ "a", "b" }) |value| try std.testing.expectEqualStrings(value, (try it.next()).data);
+        if (max_len < long.len) {
+            try std.testing.expectError(error.FieldTooLong, it.next());
+            continue;
+        }
+        try std.testing.expectEqualStrings(long, (try it.next()).data);
+        for ([_]string{ "c", "d", "e" }) |value| try std.testing.expectEqualStrings(value, (try it.next()).data);
+        try std.testing.expectError(error.EOF, it.next());
+        // the reader got its own buffer back.
+        try std.testing.expectEqual(@as([*]u8, &buffer), reader.interface.buffer.ptr);
+    }
+}
+
+fn joinChunks(comptime dialect: csvz.Dialect, dir: std.fs.Dir, data: string, buffer_size: usize) ![]u8 {
+    try dir.writeFile(.{ .sub_path = "data.csv", .data = data });
+    const file = try dir.openFile("data.csv", .{});
+    defer file.close();
+    const buffer = try std.testing.allocator.alloc(u8, buffer_size);
+    defer std.testing.allocator.free(buffer);
+    var reader = file.reader(buffer);
+    var it = csvz.Csv(dialect).init(&reader.interface);
+
+    var out: std.Io.Writer.Allocating = .init(std.testing.allocator);
+    defer out.deinit();
+    while (true) {
+        var chunk = it.nextChunk() catch |err| switch (err) {
+            error.EOF => break,
+            else => |e| return e,
+        };
+        try std.testing.expect(chunk.data.len <= buffer_size);
+        try out.writer.writeAll(chunk.unescaped());
+        if (!chunk.partial) try out.writer.writeByte(if (chunk.last_column) '\n' else ',');
+    }
+    return out.toOwnedSlice();
+}
+
+test "chunked fields" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const quoted = "ab\"\"c,\r\n" ** 20;
+    const unquoted = "y" ** 100;
+    const data = "id,\"" ++ quoted ++ "\"\r\nx," ++ unquoted ++ "\r\n\"z\"\"\",w";
+    const expected = "id," ++ ("ab\"c,\r\n" ** 20) ++ "\nx," ++ unquoted ++ "\nz\",w\n";
+
+    // escaped quotes and "\r\n" terminators end up cut off at every position.
+    for (10..40) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for ([_]csvz.Dialect{ .{}, .{ .lenient = true } }) |dialect| {
+            const joined = try joinChunks(dialect, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings(expected, joined);
+        }
+    }
+
+    // fields that fit are returned whole.
+    var reader = std.Io.Reader.fixed("a,\"b\"\"\"\n");
+    var it = csvz.Iterator.init(&reader);
+    try std.testing.expectEqualStrings("a", (try it.nextChunk()).data);
+    var field = try it.nextChunk();
+    try std.testing.expect(!field.partial and field.last_column);
+    try std.testing.expectEqualStrings("b\"", field.unescaped());
+    try std.testing.expectError(error.EOF, it.nextChunk());
+}
+
+test "trim" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const data = "  a , b\t,  \" c \" ,d  \r\n  \"e\"\t,  \n x y ,z";
+    for (12..48) |buffer_size| {
+        errdefer std.debug.print("\nbuffer_size={d}\n", .{buffer_size});
+        inline for (.{ null, 16 }) |vector_length| {
+            const joined = try joinFields(.{ .trim = .all, .vector_length = vector_length }, tmp.dir, data, buffer_size);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("a,b, c ,d\ne,\nx y,z\n", joined);
+        }
+        {
+            // blanks inside a field that is returned in chunks are kept.
+            const joined = try joinChunks(.{ .trim = .unquoted }, tmp.dir, "  " ++ "ab  " ** 6 ++ "  ,  y \n", buffer_size - 4);
+            defer std.testing.allocator.free(joined);
+            try std.testing.expectEqualStrings("ab  " ** 5 ++ "ab,y\n", joined);
+        }
+    }
+
+    // quoted data is never trimmed.
+    var reader = std.Io.Reader.fixed("\" a \", b \n");
+    var it = csvz.Csv(.{ .trim = .unquoted }).init(&reader);
+    try std.testing.expectEqualStrings(" a ", (try it.next()).data);
+    try std.testing.expectEqualStrings("b", (try it.next()).data);
+    try std.testing.expectError(error.EOF, it.next());
+}
+
+test "ring reader" {
+    if (@import("builtin").os.tag != .linux) return error.SkipZigTest;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    // rows of growing quoted fields, so fields span the end of the window at every offset.
+    var data: std.Io.Writer.Allocating = .init(std.testing.allocator);
+    defer data.deinit();
+    var expected: std.Io.Writer.Allocating = .init(std.testing.allocator);
+    defer expected.deinit();
+    for (0..300) |i| {
+        try data.writer.print("{d},\"", .{i});
+        try expected.writer.print("{d},", .{i});
+        for (0..i) |j| {
+            try data.writer.writeAll(if (j % 7 == 0) "\"\"" else "x");
+            try expected.writer.writeAll(if (j % 7 == 0) "\"" else "x");
+        }
+        try data.writer.writeAll("\"\r\n");
+        try expected.writer.writeByte('\n');
+    }
+    try tmp.dir.writeFile(.{ .sub_path = "data.csv", .data = data.written() });
+
+    const file = try tmp.dir.openFile("data.csv", .{});
+    defer file.close();
+    var ring = try csvz.RingReader.init(file, 1);
+    defer ring.deinit();
+    var it = csvz.Iterator.init(&ring.interface);
+
+    var out: std.Io.Writer.Allocating = .init(std.testing.allocator);
+    defer out.deinit();
+    while (true) {
+        var field = it.next() catch |err| switch (err) {
+            error.EOF => break,
+            else => |e| return e,
+        };
+        try out.writer.writeAll(field.unescaped());
+        try out.writer.writeByte(if (field.last_column) '\n' else ',');
+    }
+    try std.testing.expectEqualStrings(expected.written(), out.written());
+}
+
+test "calibrate" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const sample = "a,b,\"c\"\"d\",1.5\n" ** 64;
+
+    const tuning = try csvz.loadOrCalibrate(std.testing.allocator, tmp.dir, sample, .{});
+    try std.testing.expect(tuning.buffer_size > 0);
+    // the second call reads the cache.
+    try std.testing.expectEqual(tuning, try csvz.loadOrCalibrate(std.testing.allocator, tmp.dir, "", .{}));
+    try std.testing.expectError(error.InvalidDialect, csvz.calibrate(std.testing.allocator, sample, .{ .quote = ',' }));
+}
@@ -0,0 +1,147 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const iterator = @import("iterator.zig");
+const dynamic = @import("dynamic.zig");
+const Reader = std.Io.Reader;
+const Writer = std.Io.Writer;
+const Allocator = std.mem.Allocator;
+
+/// Result of `calibrate`.
+pub const Tuning = struct {
+    /// Fastest reader buffer size in bytes.
+    buffer_size: usize,
+};
+
+/// Buffer sizes `calibrate` compares.
+pub const buffer_candidates = [_]usize{ 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+
+/// Bytes parsed per measurement, small samples are parsed several times.
+const bytes_per_measurement = 1024 * 1024;
+/// Measurements per candidate, the fastest one counts.
+const measurements = 3;
+
+/// Times every size of `buffer_candidates` on `sample`, read in buffer sized chunks like a file, and returns
+/// the fastest one. The sample is parsed by the iterator `AnyIterator.select` picks for `settings`, the one
+/// the C constructors use, with the vector length the library was built with (see `-Dvector-length`). `sample` should be a few hundred KiB to a few MiB of the actual
+/// input; buffer sizes larger than the sample are not considered. Sizes that cannot parse the sample (a
+/// field longer than the buffer) are skipped.
+pub fn calibrate(allocator: Allocator, sample: []const u8, settings: iterator.RuntimeDialect) error{ OutOfMemory, InvalidDialect }!Tuning {
+    if (!settings.isValid()) return error.InvalidDialect;
+    const buffer = try allocator.alloc(u8, buffer_candidates[buffer_candidates.len - 1]);
+    defer allocator.free(buffer);
+
+    var best: Tuning = .{ .buffer_size = buffer_candidates[0] };
+    var best_time: u64 = std.math.maxInt(u64);
+    const passes = @max(1, bytes_per_measurement / @max(sample.len, 1));
+    for (buffer_candidates, 0..) |buffer_size, i| {
+        if (i > 0 and buffer_size > sample.len) break;
+        var time: u64 = std.math.maxInt(u64);
+        for (0..measurements) |_| {
+            time = @min(time, measure(sample, buffer[0..buffer_size], settings, passes));
+        }
+        if (time < best_time) {
+            best_time = time;
+            best = .{ .buffer_size = buffer_size };
+        }
+    }
+    return best;
+}
+
+/// Returns the tuning cached in `cache_dir` for the CPU model of this machine, or calibrates on `sample` and
+/// caches the result. The cache is a small text file, a missing or unreadable one is replaced.
+pub fn loadOrCalibrate(
+    allocator: Allocator,
+    cache_dir: std.fs.Dir,
+    sample: []const u8,
+    settings: iterator.RuntimeDialect,
+) !Tuning {
+    var name_buffer: [64]u8 = undefined;
+    const name = cacheName(&name_buffer);
+    if (load(cache_dir, name)) |tuning| return tuning;
+
+    const tuning = try calibrate(allocator, sample, settings);
+    var write_buffer: [128]u8 = undefined;
+    var file = try cache_dir.atomicFile(name, .{ .write_buffer = &write_buffer });
+    defer file.deinit();
+    file.file_writer.interface.print("buffer_size={d}\n", .{tuning.buffer_size}) catch
+        return file.file_writer.err.?;
+    try file.finish();
+    return tuning;
+}
+
+fn load(dir: std.fs.Dir, name: []const u8) ?Tuning {
+    var buffer: [128]u8 = undefined;
+    const data = dir.readFile(name, &buffer) catch return null;
+    var tuning: Tuning = .{ .buffer_size = 0 };
+    var lines = std.mem.tokenizeScalar(u8, data, '\n');
+    while (lines.next()) |line| {
+        const eq = std.mem.indexOfScalar(u8, line, '=') orelse return null;
+        const value = std.fmt.parseInt(usize, line[eq + 1 ..], 10) catch return null;
+        const key = line[0..eq];
+        if (std.mem.eql(u8, key, "buffer_size")) tuning.buffer_size = value;
+    }
+    return if (tuning.buffer_size > 0) tuning else null;
+}
+
+/// name of the cache file, keyed by a hash of the CPU model.
+fn cacheName(buffer: []u8) []const u8 {
+    var model_buffer: [4096]u8 = undefined;
+    const model = cpuModel(&model_buffer);
+    return std.fmt.bufPrint(buffer, "csvz-tune-{x:0>16}.txt", .{std.hash.Wyhash.hash(0, model)}) catch unreachable;
+}
+
+/// the model name of the CPU from /proc/cpuinfo on Linux, the compile target CPU model otherwise.
+fn cpuModel(buffer: []u8) []const u8 {
+    if (builtin.os.tag == .linux) {
+        if (std.fs.cwd().readFile("/proc/cpuinfo", buffer)) |info| {
+            var lines = std.mem.tokenizeScalar(u8, info, '\n');
+            while (lines.next()) |line| {
+                if (std.mem.startsWith(u8, line, "model name")) return line;
+            }
+        } else |_| {}
+    }
+    return builtin.cpu.model.name;
+}
+
+/// parses `sample` `passes` times and returns the time it took in ns, or maxInt if it is not parseable.
+fn measure(sample: []const u8, buffer: []u8, settings: iterator.RuntimeDialect, passes: usize) u64 {
+    var timer = std.time.Timer.start() catch return std.math.maxInt(u64);
+    var fields: usize = 0;
+    for (0..passes) |_| {
+        var source: SliceSource = .init(sample, buffer);
+        var it = dynamic.AnyIterator.select(&source.interface, settings) catch unreachable;
+        while (true) {
+            _ = it.next() catch |err| switch (err) {
+                error.EOF => break,
+                else => return std.math.maxInt(u64),
+            };
+            fields += 1;
+        }
+    }
+    std.mem.doNotOptimizeAway(fields);
+    return timer.read();
+}
+
+/// reads a slice through the reader buffer in buffer sized chunks, like a file.
+const SliceSource = struct {
+    data: []const u8,
+    interface: Reader,
+
+    fn init(data: []const u8, buffer: []u8) SliceSource {
+        return .{
+            .data = data,
+            .interface = .{ .buffer = buffer, .seek = 0, .end = 0, .vtable = &.{ .stream = &stream } },
+        };
+    }
+
+    fn stream(r: *Reader, w: *Writer, limit: std.Io.Limit) Reader.StreamError!usize {
+        const source: *SliceSource = @fieldParentPtr("interface", r);
+        if (source.data.len == 0) return error.EndOfStream;
+        const dest = limit.slice(try w.writableSliceGreedy(1));
+        const n = @min(dest.len, source.data.len);
+        @memcpy(dest[0..n], source.data[0..n]);
+        source.data = source.data[n..];
+        w.advance(n);
+        return n;
+    }
+};